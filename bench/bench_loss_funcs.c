@@ -0,0 +1,232 @@
+/*!
+ *  \file     bench_loss_funcs.c
+ *  \brief    Micro-benchmark of SAD/SSD loss kernels
+ *
+ *  Runs every kernel of every instruction set supported by the host over a sweep of
+ *  row widths, buffer alignments and row counts, checks the results against the C
+ *  reference, and reports ns/pixel, GB/s and speedup versus C. 16-bit kernels are
+ *  fed full-range 16-bit samples, so that their 64-bit sums are checked exactly.
+ *  A last table compares, at each width, the block row kernel (ssd2_rows_u8) against
+ *  the generic path it replaces (one row kernel call per row & statistics block), and
+ *  against its own code for block sizes known at run time only (ssd2_rows_any_u8), to
+ *  show the gain of its full-block copy.
+ *
+ *  Usage: bench_loss_funcs [min_time_ms]
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pattern_detector.h"
+#include "timer.h"
+
+/* sweep parameters */
+static const int widths[] = {720, 1280, 1366, 1920, 3840, 7680};
+static const int aligns[] = {0, 1, 8};
+static const int row_counts[] = {16, 1080};
+
+#define NUM(a)  ((int)(sizeof(a)/sizeof((a)[0])))
+
+#define ROW_PADDING  64    //!< extra bytes at the end of each row
+#define REPEATS      5     //!< measurements of each kernel of the last table, the fastest one is kept
+
+/* kernel under test */
+enum {
+  K_SAD_NX8 = 0,
+  K_SSD_NX8,
+  K_SAD_NX16,
+  K_SSD_NX16,
+  K_SSD2_NX16,
+  K_SSD2_ROW,
+  K_SSD2_ROW_BLOCKS,      //!< ssd2_row_u8 called per row & statistics block
+  K_SSD2_ROWS,
+  K_SSD2_ROWS_ANY,        //!< ssd2_rows_u8 without its full-block copy
+  K_SAD_NX8_U16,
+  K_SSD_NX8_U16,
+  K_SAD_NX16_U16,
+  K_SSD_NX16_U16,
+  K_SSD2_NX16_U16,
+  K_SSD2_ROW_U16,
+  K_TOTAL
+};
+
+static const char *kernel_names[K_TOTAL] = {"sad_nx8_u8", "ssd_nx8_u8", "sad_nx16_u8", "ssd_nx16_u8", "ssd2_nx16_u8", "ssd2_row_u8",
+                                            "ssd2_row_u8/blk", "ssd2_rows_u8", "ssd2_rows_any_u8",
+                                            "sad_nx8_u16", "ssd_nx8_u16", "sad_nx16_u16", "ssd_nx16_u16", "ssd2_nx16_u16", "ssd2_row_u16"};
+
+#define IS_U16(k)  ((k) >= K_SAD_NX8_U16)
+#define IS_SSD2(k) ((k) == K_SSD2_NX16 || (k) == K_SSD2_ROW || (k) == K_SSD2_ROW_BLOCKS || (k) == K_SSD2_ROWS || (k) == K_SSD2_ROWS_ANY || \
+                    (k) == K_SSD2_NX16_U16 || (k) == K_SSD2_ROW_U16)
+
+/* per-block frame & field sums of ssd2 block kernels (field sums of even & odd rows) */
+static uint64_t dd_frame[MAX_WIDTH / BLOCK_WIDTH + 1], dd_field[2][MAX_WIDTH / BLOCK_WIDTH + 1];
+
+/*! Run kernel k over rows, return checksum of results (stride in samples) */
+static uint64_t run_kernel (const loss_funcs_t *lf, int k, unsigned char *buf, int stride, int width, int rows)
+{
+  int i, j, c, pq, pr;
+  uint64_t sum = 0, pq64, pr64;
+  unsigned char *p;
+  uint16_t *w;
+
+  if (IS_U16(k)) {
+    for (i=0, w=(uint16_t *)buf; i<rows; i++, w+=stride) {
+      switch (k) {
+        case K_SAD_NX8_U16:   sum += lf->sad_nx8_u16 (w, w + stride, 8, width/8);    break;
+        case K_SSD_NX8_U16:   sum += lf->ssd_nx8_u16 (w, w + stride, 8, width/8);    break;
+        case K_SAD_NX16_U16:  sum += lf->sad_nx16_u16 (w, w + stride, 16, width/16); break;
+        case K_SSD_NX16_U16:  sum += lf->ssd_nx16_u16 (w, w + stride, 16, width/16); break;
+        case K_SSD2_NX16_U16:
+          lf->ssd2_nx16_u16 (w, w + stride, w + 2*stride, 16, width/16, &pq64, &pr64);
+          sum += pq64 * 3 + pr64;
+          break;
+        case K_SSD2_ROW_U16:
+          lf->ssd2_row_u16 (w, w + stride, w + 2*stride, width, &pq64, &pr64);
+          sum += pq64 * 3 + pr64;
+          break;
+      }
+    }
+    return sum;
+  }
+
+  for (i=0, p=buf; i<rows; i++, p+=stride) {
+    switch (k) {
+      case K_SAD_NX8:   sum += lf->sad_nx8_u8 (p, p + stride, 8, width/8);    break;
+      case K_SSD_NX8:   sum += lf->ssd_nx8_u8 (p, p + stride, 8, width/8);    break;
+      case K_SAD_NX16:  sum += lf->sad_nx16_u8 (p, p + stride, 16, width/16); break;
+      case K_SSD_NX16:  sum += lf->ssd_nx16_u8 (p, p + stride, 16, width/16); break;
+      case K_SSD2_NX16:
+        lf->ssd2_nx16_u8 (p, p + stride, p + 2*stride, 16, width/16, &pq, &pr);
+        sum += (uint64_t)pq + ((uint64_t)pr << 32);
+        break;
+      case K_SSD2_ROW:
+        lf->ssd2_row_u8 (p, p + stride, p + 2*stride, width, &pq, &pr);
+        sum += (uint64_t)pq + ((uint64_t)pr << 32);
+        break;
+      case K_SSD2_ROW_BLOCKS:
+        for (c=0, j=0; j<width; c++, j+=BLOCK_WIDTH) {
+          lf->ssd2_row_u8 (p+j, p+j + stride, p+j + 2*stride, min(BLOCK_WIDTH, width - j), &pq, &pr);
+          dd_frame[c] += pq;
+          dd_field[i & 1][c] += pr;
+        }
+        break;
+      case K_SSD2_ROWS:
+        if (i % BLOCK_HEIGHT == 0)
+          lf->ssd2_rows_u8 (p, stride, width, min(BLOCK_HEIGHT, rows - i), min(BLOCK_HEIGHT, rows - i), dd_frame, dd_field[0], dd_field[1]);
+        break;
+      case K_SSD2_ROWS_ANY:
+        if (i % BLOCK_HEIGHT == 0)
+          lf->ssd2_rows_any_u8 (p, stride, width, min(BLOCK_HEIGHT, rows - i), min(BLOCK_HEIGHT, rows - i), dd_frame, dd_field[0], dd_field[1]);
+        break;
+    }
+  }
+  if (k == K_SSD2_ROW_BLOCKS || k == K_SSD2_ROWS || k == K_SSD2_ROWS_ANY) {
+    for (c=0; c*BLOCK_WIDTH<width; c++) {
+      sum += dd_frame[c] * (c + 1) + dd_field[0][c] * (c + 2) + dd_field[1][c] * (c + 3);
+      dd_frame[c] = dd_field[0][c] = dd_field[1][c] = 0;
+    }
+  }
+  return sum;
+}
+
+/*! Time kernel k, return seconds per call & checksum */
+static double time_kernel (const loss_funcs_t *lf, int k, unsigned char *buf, int stride, int width, int rows, double min_time, uint64_t *checksum)
+{
+  timestamp_t start_time, stop_time;
+  double t = 0.;
+  long iters = 0, batch = 1, j;
+
+  *checksum = run_kernel(lf, k, buf, stride, width, rows);   // warm-up
+  do {
+    get_time(&start_time);
+    for (j=0; j<batch; j++)
+      run_kernel(lf, k, buf, stride, width, rows);
+    get_time(&stop_time);
+    t += elapsed_time(&start_time, &stop_time);
+    iters += batch;
+    batch *= 2;
+  } while (t < min_time);
+
+  return t / iters;
+}
+
+int main (int argc, char *argv[])
+{
+  double min_time = (argc > 1)? atof(argv[1]) / 1000.: 0.02;
+  int cpu_type = cpu_asm_type();
+  int k, w, a, r, t, i, n, stride, width, rows, errors = 0;
+  unsigned char *buf, *base, *base16;
+  double sec, sec_c, sec_row, sec_any, pixels, bytes;
+  uint64_t sum, sum_c, sum_any;
+  const loss_funcs_t *lf;
+
+  /* allocate & fill test buffer (max rows + 2 extra rows for ssd2) */
+  stride = widths[NUM(widths)-1] + ROW_PADDING;
+  base = (unsigned char *) malloc((size_t)stride * (row_counts[NUM(row_counts)-1] + 2) + 64);
+  base16 = (unsigned char *) malloc((size_t)stride * (row_counts[NUM(row_counts)-1] + 2) * 2 + 64);
+  if (!base || !base16) {fprintf(stderr, "ERROR: Out of memory.\n"); return 1;}
+  srand(1);
+  for (i=0; i<stride * (row_counts[NUM(row_counts)-1] + 2) + 64; i++)
+    base[i] = (unsigned char)(rand() & 0xFF);
+  for (i=0; i<stride * (row_counts[NUM(row_counts)-1] + 2) * 2 + 64; i++)
+    base16[i] = (unsigned char)(rand() & 0xFF);
+
+  printf("Loss kernel benchmark (host supports up to %s)\n\n", get_loss_funcs(ASM_AUTO)->name);
+  printf("%-13s %-10s %6s %6s %6s %10s %9s %9s  %s\n", "kernel", "isa", "width", "align", "rows", "ns/pixel", "GB/s", "speedup", "check");
+
+  for (k=0; k<K_TOTAL; k++)
+  for (w=0; w<NUM(widths); w++)
+  for (a=0; a<NUM(aligns); a++)
+  for (r=0; r<NUM(row_counts); r++) {
+    width = widths[w];
+    rows = row_counts[r];
+    buf = (IS_U16(k)? base16: base) + aligns[a];
+    pixels = (double)width * rows;
+    bytes = pixels * (IS_SSD2(k)? 3: 2) * (IS_U16(k)? 2: 1);
+
+    sec_c = time_kernel(get_loss_funcs(ASM_C), k, buf, stride, width, rows, min_time, &sum_c);
+    for (t=ASM_C; t<=cpu_type; t++) {
+      lf = get_loss_funcs(t);
+      sec = (t == ASM_C)? sec_c: time_kernel(lf, k, buf, stride, width, rows, min_time, &sum);
+      if (t != ASM_C && sum != sum_c) errors ++;
+      printf("%-13s %-10s %6d %6d %6d %10.4f %9.2f %8.2fx  %s\n", kernel_names[k], lf->name, width, aligns[a], rows,
+             sec * 1e9 / pixels, bytes / sec / 1e9, sec_c / sec, (t == ASM_C || sum == sum_c)? "ok": "MISMATCH");
+    }
+  }
+
+  /* block row kernel vs generic path & vs its own run-time size code at the same width, on a full frame of aligned rows */
+  rows = row_counts[NUM(row_counts)-1];
+  printf("\nPer-block frame & field SSDs of %d rows: ssd2_row_u8 per row & block (generic), ssd2_rows_u8 with block sizes\n"
+         "at run time only (any) and with its full-block copy (rows)\n\n", rows);
+  printf("%-10s %6s %15s %11s %12s %11s %9s  %s\n", "isa", "width", "generic ns/px", "any ns/px", "rows ns/px", "vs generic", "vs any", "check");
+  for (t=ASM_C; t<=cpu_type; t++)
+  for (w=0; w<NUM(widths); w++) {
+    lf = get_loss_funcs(t);
+    width = widths[w];
+    pixels = (double)width * rows;
+    sec_row = sec_any = sec = 1e30;
+    for (n=0; n<REPEATS; n++) {   // interleaved, so that all kernels see the same machine load
+      sec_row = min(sec_row, time_kernel(lf, K_SSD2_ROW_BLOCKS, base, stride, width, rows, min_time, &sum_c));
+      sec_any = min(sec_any, time_kernel(lf, K_SSD2_ROWS_ANY, base, stride, width, rows, min_time, &sum_any));
+      sec = min(sec, time_kernel(lf, K_SSD2_ROWS, base, stride, width, rows, min_time, &sum));
+    }
+    if (sum != sum_c || sum_any != sum_c) errors ++;
+    printf("%-10s %6d %15.4f %11.4f %12.4f %10.2fx %8.2fx  %s\n", lf->name, width, sec_row * 1e9 / pixels, sec_any * 1e9 / pixels,
+           sec * 1e9 / pixels, sec_row / sec, sec_any / sec, (sum == sum_c && sum_any == sum_c)? "ok": "MISMATCH");
+  }
+
+  free(base);
+  free(base16);
+  if (errors) {
+    fprintf(stderr, "ERROR: %d kernel results differ from C reference.\n", errors);
+    return 1;
+  }
+  return 0;
+}
@@ -30,8 +30,8 @@ typedef union {
 } timestamp_t;
 
 /* functions: */
-void get_time (timestamp_t *t);                             //!< records current time
-double elapsed_time (timestamp_t *start, timestamp_t *end);	//!< computes time difference between 2 events [in milliseconds]
+void get_time (timestamp_t *t);                             //!< records current (monotonic) time
+double elapsed_time (timestamp_t *start, timestamp_t *end);	//!< computes time difference between 2 events [in seconds]
 
 #ifdef __cplusplus
 }
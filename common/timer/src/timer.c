@@ -20,16 +20,16 @@
 #include "timer.h"
 
 /*!
- *  \brief Read system time 
+ *  \brief Read monotonic time (not affected by system clock adjustments)
  *
- *  \param[out]  t   - pointer to timestamp_t structure to contain record of system time
+ *  \param[out]  t   - pointer to timestamp_t structure to contain record of time
  */
 void get_time (timestamp_t *t)
 {
 #ifdef _MSC_VER 
   QueryPerformanceCounter ((PLARGE_INTEGER)&t->cpu_counter);
 #else
-  clock_gettime(CLOCK_REALTIME, (struct timespec*)&t->time_spec);
+  clock_gettime(CLOCK_MONOTONIC, (struct timespec*)&t->time_spec);
 #endif
 }
 
@@ -39,7 +39,7 @@ void get_time (timestamp_t *t)
  *  \param[in]  start  - start time
  *  \param[in]  end    - end time
  * 
- *  \returns    elapsed time [in milliseconds]
+ *  \returns    elapsed time [in seconds]
  */
 double elapsed_time (timestamp_t *start, timestamp_t *end)
 {
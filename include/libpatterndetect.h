@@ -0,0 +1,159 @@
+/*!
+ *  \file     libpatterndetect.h
+ *  \brief    Scan pattern detection library
+ *
+ *  A detector context is created for a given resolution, chroma format and bitdepth,
+ *  and fed with the luma plane of each frame (or with all planes, by pd_push_planes(),
+ *  if chroma planes are analyzed too):
+ *
+ *    pd_context_t *pd = pd_create(&params);
+ *    while (...)
+ *      if (pd_push_frame(pd, luma, stride, NULL) != 0) break;   // decided, or error
+ *    pd_get_result(pd, &result);
+ *    pd_destroy(pd);
+ *
+ *  To analyze several frames concurrently, pd_push_frame() is split in two steps:
+ *  pd_analyze_frame() is thread-safe and can run on any number of threads, each with
+ *  its own pd_frame_t, while pd_commit_frame() must be called in frame order. If
+ *  crop_interval is set, pd_detect_area() must also be called in frame order, before
+ *  each frame is analyzed, so that the area of a frame only depends on its index. The
+ *  library keeps no global state and does not print anything.
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#ifndef _LIBPATTERNDETECT_H_
+#define _LIBPATTERNDETECT_H_  1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* symbols exported by shared library */
+#if defined(_MSC_VER)
+#define PD_API
+#else
+#define PD_API __attribute__((visibility("default")))
+#endif
+
+/*! Kernel ASM type, index into kernel function tables */
+enum {
+  ASM_AUTO = -1,                //!< fastest type supported by CPU
+  ASM_C = 0,
+  ASM_SSE2 = 1,
+  ASM_AVX2 = 2,
+  ASM_AVX512 = 3,               //!< AVX-512BW
+  ASM_AVX512_VNNI = 4,          //!< AVX-512BW with VNNI
+  ASM_TYPE_TOTAL
+};
+
+/*! Scan order type */
+enum {
+  SCAN_UNKNOWN = 0,
+  SCAN_PROGRESSIVE = 1,
+  SCAN_INTERLACE_TFF = 2,
+  SCAN_INTERLACE_BFF = 3
+};
+
+/*! Chroma sampling format */
+enum {
+  FORMAT_UNKNOWN = 0,
+  FORMAT_YUV420 = 1,
+  FORMAT_YUV422 = 2,
+  FORMAT_YUV444 = 3,
+  FORMAT_YUV400 = 4           //!< luma only
+};
+
+/*! Detector parameters */
+typedef struct {
+  int width, height;          //!< frame resolution [in pixels]
+  int format;                 //!< chroma format (FORMAT_YUV420, ...); only the luma plane is analyzed unless chroma is set
+  int bitdepth;               //!< sample bitdepth, frames with bitdepth > 8 hold 16-bit samples
+  int asm_type;               //!< kernel instruction set, ASM_AUTO for the fastest one supported
+  int band_threads;           //!< number of extra threads analyzing row bands of each frame (0 = off)
+  int cascade;                //!< !0 to analyze frames on decimated rows & columns, at full resolution only if ambiguous
+  int crop_interval;          //!< detect black bars every crop_interval frames & analyze the active area only (0 = off)
+  double confidence;          //!< confidence required to decide the scan type, 0 for default
+  int chroma;                 //!< !0 to analyze chroma planes too (frames pushed by pd_push_planes/pd_analyze_planes)
+} pd_params_t;
+
+/*! Statistics & field matching decision for one frame */
+typedef struct {
+  float delta_frame;          //!< average squared difference of adjacent rows
+  float delta_even;           //!< average squared difference of even field rows
+  float delta_odd;            //!< average squared difference of odd field rows
+  float gamma;                //!< delta_frame / (delta_even + delta_odd)
+  int combed_blocks;          //!< number of blocks with gamma above 1
+  char match;                 //!< 'c' (match fields of this frame) or 'p' (first field with second field of previous frame)
+  int drop;                   //!< !0 if frame is a duplicate after field matching
+  int phase;                  //!< position in 3:2 cadence cycle, -1 if no cadence is locked
+  int order;                  //!< field order voted by this frame: SCAN_INTERLACE_TFF, SCAN_INTERLACE_BFF or SCAN_UNKNOWN
+  int escalated;              //!< !0 if cascade analyzed frame again at full resolution
+  float gamma_u, gamma_v;     //!< gamma of chroma planes, 0 if chroma is not analyzed
+} pd_frame_result_t;
+
+/*! Detection result over the frames pushed so far */
+typedef struct {
+  int frames;                 //!< number of frames pushed
+  int scan_type;              //!< SCAN_PROGRESSIVE, SCAN_INTERLACE_TFF/BFF from histograms, SCAN_UNKNOWN if no frame shows detail
+  int decided;                //!< !0 once scan type is known with required confidence (scan can stop)
+  int telecine;               //!< !0 if 3:2 cadence is currently locked
+  int combed_frames;          //!< number of frames with at least one combed block
+  int escalated_frames;       //!< number of frames analyzed again at full resolution by cascade
+  int locked_frames;          //!< number of frames within a locked 3:2 cadence
+  int breaks;                 //!< number of times a locked cadence was broken
+  int drops;                  //!< number of frames to drop after field matching
+  int tff_votes, bff_votes;   //!< field order votes
+  int observed;               //!< number of frames not too flat to show combing
+  int combed;                 //!< number of observed frames with gamma above 1
+  double llr;                 //!< log-likelihood ratio of combed vs progressive content
+  double gamma_mean, gamma_stddev;
+  double delta_even_mean, delta_even_stddev;
+  double delta_odd_mean, delta_odd_stddev;
+  double gamma_median;        //!< median gamma of observed frames
+  double field_diff_median;   //!< median |delta_even - delta_odd| / (delta_even + delta_odd) of observed frames
+  int area_x, area_y;         //!< active area last detected (whole frame if none)
+  int area_width, area_height;
+  int chroma_frames;          //!< number of frames with chroma planes analyzed
+  int chroma_combed_frames;   //!< number of frames with gamma above 1 in a chroma plane but not in luma
+  double gamma_u_mean, gamma_v_mean;  //!< mean gamma of chroma planes
+} pd_result_t;
+
+/*! Detector context */
+typedef struct pd_context pd_context_t;
+
+/*! Per-frame analysis state, passed from pd_analyze_frame() to pd_commit_frame() */
+typedef struct frame_stats pd_frame_t;
+
+/* Context */
+PD_API pd_context_t *pd_create (const pd_params_t *params);
+PD_API void pd_destroy (pd_context_t *pd);
+PD_API int pd_get_result (pd_context_t *pd, pd_result_t *result);
+PD_API int pd_merge (pd_context_t *dst, const pd_context_t *src);
+PD_API const char *pd_kernels_name (pd_context_t *pd);
+PD_API void pd_reset (pd_context_t *pd);
+
+/* Frames */
+PD_API int pd_push_frame (pd_context_t *pd, const unsigned char *luma, int stride, pd_frame_result_t *result);
+PD_API pd_frame_t *pd_frame_create (void);
+PD_API int pd_detect_area (pd_context_t *pd, pd_frame_t *frame, const unsigned char *luma, int stride, int index);
+PD_API void pd_frame_destroy (pd_frame_t *frame);
+PD_API int pd_analyze_frame (pd_context_t *pd, pd_frame_t *frame, const unsigned char *luma, int stride);
+PD_API int pd_commit_frame (pd_context_t *pd, pd_frame_t *frame, pd_frame_result_t *result);
+PD_API int pd_push_planes (pd_context_t *pd, const unsigned char *const planes[3], const int strides[3], pd_frame_result_t *result);
+PD_API int pd_analyze_planes (pd_context_t *pd, pd_frame_t *frame, const unsigned char *const planes[3], const int strides[3]);
+PD_API void pd_restart (pd_context_t *pd);
+
+/* Helpers */
+PD_API int pd_frame_size (int width, int height, int format, int bitdepth);
+PD_API const char *pd_scan_type_name (int scan_type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIBPATTERNDETECT_H_ */
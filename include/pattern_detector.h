@@ -16,6 +16,13 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "libpatterndetect.h"
+#include "timer.h"
+
 #ifndef VERSION
 #define VERSION "1.0.0"
 #endif
@@ -39,33 +46,63 @@ extern "C" {
 #define BINS                      100         //!< numbed of bins in histogram
 #define MIN_FIELD_DIFF            0           //!< min odd, even field difference 
 #define MAX_FIELD_DIFF            0.5         //!< max odd, even field difference
+#define MAX_THREADS               256         //!< max number of worker threads
+#define MAX_BANDS                 64          //!< max number of row bands per plane
+#define MIN_BAND_HEIGHT           32          //!< min number of rows in a band
+#define BLOCK_HEIGHT              WINSIZE_HEIGHT          //!< height of statistics block [in rows]
+#define BLOCK_WIDTH               (WINSIZE_WIDTH * 16)    //!< width of statistics block [in pixels], WINSIZE_WIDTH kernel blocks
+#define COMB_GAMMA_THRESHOLD      1.0         //!< block gamma above which a block is considered combed
+#define MAX_SAMPLE_SEGMENTS       10000       //!< max number of segments sampled by --sample
+#define CADENCE_CYCLE             5           //!< frames per telecine cadence cycle
+#define CADENCE_WINDOW            10          //!< number of recent field matches checked against cadence
+#define MATCH_RATIO               0.7         //!< field match is taken if its SAD is below this fraction of the other
+#define ORDER_RATIO               0.8         //!< field order vote is cast if one order's SAD is below this fraction of the other
+#define PD_DEFAULT_CONFIDENCE     0.999       //!< confidence required to decide the scan type, if not given
+#define EARLY_EXIT_P_PROGRESSIVE  0.02        //!< combed-frame rate assumed for progressive content
+#define EARLY_EXIT_P_COMBED       0.3         //!< combed-frame rate assumed for interlaced or telecined content
+#define EARLY_EXIT_WINDOW         48          //!< number of frames an early-exit decision must hold before the scan stops
+#define FLAT_FIELD_DELTA          1.0         //!< field deltas (even + odd) below which a frame is too flat to show combing
+#define CASCADE_ROW_STEP          10          //!< cascade coarse pass compares 2 rows every CASCADE_ROW_STEP rows (even, divides BLOCK_HEIGHT)
+#define CASCADE_PITCH             64          //!< cascade coarse pass compares one 16-pixel kernel block every CASCADE_PITCH pixels
+#define CASCADE_GAMMA_LOW         0.75        //!< coarse gamma from which cascade escalates a frame to full resolution
+#define CASCADE_GAMMA_HIGH        1.33        //!< coarse gamma up to which cascade escalates a frame to full resolution
+#define CROP_BLACK_LEVEL          24          //!< mean 8-bit luma up to which a row or column belongs to black bars
+#define CROP_ROW_STEP             8           //!< rows sampled for column energies of active area detection
+#define STREAM_RING_FRAMES        8           //!< number of frame buffers read ahead from non-seekable inputs
+#define STATS_LOG_CHUNK_FRAMES    1024        //!< number of frames per chunk of binary stats log (multiple of 8)
+#define PROFILE_OCTAVES           36          //!< stage durations are binned up to 2^36 ns (~69 s)
+#define PROFILE_BINS_PER_OCTAVE   16          //!< duration bins per power of 2 (~4% resolution)
+#define PROFILE_RING              1024        //!< frames in flight tracked for latency (> pipeline slots)
 
 /* line buffer length */
 #define STRLEN  4096
 
+/* Y4M stream signature */
+#define Y4M_SIGNATURE   "YUV4MPEG2"
+
+/* binary stats log signature & version */
+#define STATS_LOG_MAGIC     "PDSTATS"
+#define STATS_LOG_VERSION   1
+
 
 /* Intel X86 SIMD Mask */
 #define PREAVX2_MASK    1
 #define AVX2_MASK       2
 #ifndef NON_AVX512_SUPPORT
 #define AVX512_MASK     4
+#define AVX512_VNNI_MASK  8
 #endif
 #define ASM_AVX2_BIT    3
 
-/*! Scan order type */
-enum {
-  SCAN_UNKNOWN = 0,
-  SCAN_PROGRESSIVE = 1,
-  SCAN_INTERLACE_TFF = 2, 
-  SCAN_INTERLACE_BFF = 3
-};
+/* environment variable overriding kernel ASM type */
+#define ASM_ENV_VAR     "DETECT_PATTERN_ASM"
 
-/*! Chroma sampling format */
+/*! Input reader mode */
 enum {
-  FORMAT_UNKNOWN = 0,
-  FORMAT_YUV420 = 1,
-  FORMAT_YUV422 = 2, 
-  FORMAT_YUV444 = 3
+  READER_STDIO = 0,           //!< fread() frames into buffers
+  READER_MMAP = 1,            //!< zero-copy access to memory-mapped file
+  READER_LUMA = 2,            //!< pread() luma planes only, skipping chroma
+  READER_STREAM = 3           //!< non-seekable input read ahead into a ring of frame buffers by a separate thread
 };
 
 /* 
@@ -75,9 +112,294 @@ enum {
 /*! Video resolution */
 typedef struct {int width, height;} res_t;
 
+/*! Rectangle within a frame [in pixels] */
+typedef struct {int x, y, width, height;} crop_t;
+
+/*! Plane of samples in memory, rows stride bytes apart (padded, cropped or mapped buffers are used in place) */
+typedef struct {
+  unsigned char *data;        //!< top-left sample
+  int stride;                 //!< distance between rows [in bytes]
+  int width, height;          //!< plane size [in samples]
+  int bitdepth;               //!< sample bitdepth, planes with bitdepth > 8 hold 16-bit samples
+} plane_t;
+
 /*! Video framerate */
 typedef struct {int num, denom;} fps_t;
 
+/*! Y4M stream parameters */
+typedef struct {
+  res_t res;
+  fps_t fps;
+  int format;                 //!< FORMAT_YUV420, ...
+  int bitdepth;
+  int scan_type;              //!< SCAN_* from interlacing tag, SCAN_UNKNOWN if absent or mixed
+} y4m_info_t;
+
+/*! SAD/SSD kernel over n blocks spaced pitch bytes apart */
+typedef int (*loss_func_t) (unsigned char *p, unsigned char *q, int pitch, int n);
+
+/*! Fused SSD kernel comparing p against both q and r */
+typedef void (*loss2_func_t) (unsigned char *p, unsigned char *q, unsigned char *r, int pitch, int n, int *ssd_pq, int *ssd_pr);
+
+/*! SAD/SSD kernel over n blocks of 16-bit samples spaced pitch samples apart, with 64-bit sum */
+typedef uint64_t (*loss16_func_t) (uint16_t *p, uint16_t *q, int pitch, int n);
+
+/*! Fused SSD kernel comparing 16-bit samples of p against both q and r */
+typedef void (*loss16_2_func_t) (uint16_t *p, uint16_t *q, uint16_t *r, int pitch, int n, uint64_t *ssd_pq, uint64_t *ssd_pr);
+
+/*! Fused SSD kernel comparing row p against rows q and r, over n samples of any count */
+typedef void (*row2_func_t) (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr);
+
+/*! Fused SSD kernel comparing row p of 16-bit samples against rows q and r, over n samples of any count */
+typedef void (*row16_2_func_t) (uint16_t *p, uint16_t *q, uint16_t *r, int n, uint64_t *ssd_pq, uint64_t *ssd_pr);
+
+/*! Fused SSD kernel comparing up to BLOCK_HEIGHT rows against their next row & field partner, adding the SSDs of each statistics block */
+typedef void (*rows2_func_t) (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1);
+
+/*! Downscaling kernel: n output pixels, each the average of 2x2 pixels of rows a & b */
+typedef void (*downscale_func_t) (unsigned char *a, unsigned char *b, unsigned char *out, int n);
+
+/*! Table of loss kernels for one ASM type */
+typedef struct {
+  int asm_type;               //!< ASM_C, ASM_SSE2, ...
+  const char *name;           //!< name used by --asm option
+  loss_func_t sad_nx8_u8;
+  loss_func_t ssd_nx8_u8;
+  loss_func_t sad_nx16_u8;
+  loss_func_t ssd_nx16_u8;
+  loss2_func_t ssd2_nx16_u8;
+  loss16_func_t sad_nx8_u16;  //!< 16-bit sample kernels, used for bitdepth > 8
+  loss16_func_t ssd_nx8_u16;
+  loss16_func_t sad_nx16_u16;
+  loss16_func_t ssd_nx16_u16;
+  loss16_2_func_t ssd2_nx16_u16;
+  downscale_func_t avg_2x2_u8;  //!< field signatures
+  row2_func_t ssd2_row_u8;    //!< whole rows, tails within the row
+  row16_2_func_t ssd2_row_u16;
+  rows2_func_t ssd2_rows_u8;  //!< row of statistics blocks
+  rows2_func_t ssd2_rows_any_u8;  //!< same, block sizes at run time only (reference for the benchmark)
+} loss_funcs_t;
+
+/*! Sums of squared row differences accumulated over a plane */
+typedef struct {
+  uint64_t dd_frame;          //!< rows i vs i+1
+  uint64_t dd_even;           //!< even field rows (2i vs 2i+2)
+  uint64_t dd_odd;            //!< odd field rows (2i+1 vs 2i+3)
+} delta_sums_t;
+
+/*! Per-block sums of squared row differences, blocks of BLOCK_HEIGHT x BLOCK_WIDTH pixels */
+typedef struct {
+  int cols, rows;             //!< number of blocks across & down
+  int capacity;               //!< allocated number of blocks
+  uint64_t *dd_frame;         //!< rows i vs i+1, cols x rows array in raster order
+  uint64_t *dd_even;          //!< even field rows
+  uint64_t *dd_odd;           //!< odd field rows
+} block_map_t;
+
+/*! Field signatures: each field of a frame downscaled by 2x2 averaging */
+typedef struct {
+  int width, height;          //!< signature size [in pixels]
+  int capacity;               //!< allocated size of each signature
+  unsigned char *top;         //!< top field signature
+  unsigned char *bottom;      //!< bottom field signature
+} field_sig_t;
+
+/*! Per-frame analysis results (pd_frame_t of library API) */
+typedef struct frame_stats {
+  float delta_frame;          //!< average squared difference of adjacent rows
+  float delta_even;           //!< average squared difference of even field rows
+  float delta_odd;            //!< average squared difference of odd field rows
+  float gamma;                //!< delta_frame / (delta_even + delta_odd)
+  int combed_blocks;          //!< number of blocks with gamma above COMB_GAMMA_THRESHOLD
+  int escalated;              //!< !0 if cascade analyzed frame again at full resolution
+  int chroma;                 //!< !0 if chroma planes were analyzed
+  float chroma_gamma[2];      //!< gamma of U & V planes, 0 if chroma was not analyzed
+  crop_t area;                //!< active area the statistics are computed on
+  block_map_t blocks;         //!< per-block statistics of active area
+  block_map_t chroma_blocks[2];  //!< per-block statistics of active area of U & V planes
+  field_sig_t fields;         //!< field signatures
+} frame_stats_t;
+
+/*! Field matching decision for one frame */
+typedef struct {
+  char match;                 //!< 'c' (match fields of this frame) or 'p' (first field with second field of previous frame)
+  int drop;                   //!< !0 if frame is a duplicate after field matching
+  int phase;                  //!< position in cadence cycle, -1 if no cadence is locked
+  int order;                  //!< field order voted by this frame: SCAN_INTERLACE_TFF, SCAN_INTERLACE_BFF or SCAN_UNKNOWN
+  int compared;               //!< !0 if fields were compared with fields of the previous frame
+  float order_metric;         //!< (bff_sad - tff_sad) / (bff_sad + tff_sad), > 0 if fields are closer in top-first order
+} cadence_result_t;
+
+/*! Telecine cadence detector */
+typedef struct {
+  const loss_funcs_t *lf;
+  field_sig_t prev;           //!< field signatures of previous frame
+  char window[CADENCE_WINDOW];  //!< recent field matches ('c', 'p', or '?' if ambiguous), indexed by frame % CADENCE_WINDOW
+  int frames;                 //!< number of frames pushed
+  int phase;                  //!< locked cadence alignment, -1 if none
+  int breaks;                 //!< number of times a locked cadence was broken
+  int locked_frames;          //!< number of frames within a locked cadence
+  int drops;                  //!< number of frames to drop
+  int tff_votes, bff_votes;   //!< field order votes
+} cadence_t;
+
+/*! Running mean & variance */
+typedef struct {
+  int n;
+  double mean;
+  double m2;                  //!< sum of squared deviations from mean
+} running_stats_t;
+
+/*! Sequential test on combed-frame rate, for early termination of the scan */
+typedef struct {
+  double confidence;          //!< confidence required to stop
+  double lower, upper;        //!< decision thresholds on llr
+  double llr;                 //!< log-likelihood ratio of combed vs progressive content
+  int frames;                 //!< number of frames pushed
+  int observed;               //!< number of frames not too flat to show combing
+  int combed;                 //!< number of observed frames with gamma above COMB_GAMMA_THRESHOLD
+  int side;                   //!< class whose threshold was reached: 1 combed, -1 progressive, 0 none
+  int stable;                 //!< number of observations the armed class held for
+  int verdict;                //!< 1 combed (interlaced or telecined), -1 progressive, 0 undecided
+  running_stats_t gamma, delta_even, delta_odd;
+} early_exit_t;
+
+/*! Streaming histogram over [min, max), values out of range are counted in the first or last bin */
+typedef struct {
+  double min, max;
+  uint64_t count;
+  uint64_t bins[BINS];
+} histogram_t;
+
+/*! Histograms of a stream classifying its scan type */
+typedef struct {
+  histogram_t gamma;          //!< gamma of frames not too flat to show combing
+  histogram_t field_diff;     //!< |delta_even - delta_odd| / (delta_even + delta_odd) of the same frames
+  histogram_t order;          //!< field order metric of frames compared with their previous frame
+} scan_hist_t;
+
+/*! Bounded lock-free queue cell */
+typedef struct {
+  size_t seq;                 //!< sequence number (accessed atomically)
+  int value;
+} queue_cell_t;
+
+/*! Bounded lock-free MPMC queue of ints */
+typedef struct {
+  queue_cell_t *cells;
+  size_t mask;                //!< capacity - 1
+  char pad0[64];
+  size_t head;                //!< next position to push
+  char pad1[64];
+  size_t tail;                //!< next position to pop
+  char pad2[64];
+} queue_t;
+
+/*! Ring of frame buffers filled by stream reader thread */
+typedef struct frame_ring frame_ring_t;
+
+/*! Input frame reader */
+typedef struct {
+  int mode;                   //!< READER_STDIO, READER_MMAP, READER_LUMA, READER_STREAM
+  FILE *file;                 //!< stdio input
+  int fd;                     //!< mapped / pread() file descriptor
+  long long frame_size;       //!< size of frame in file [in bytes]
+  long long luma_size;        //!< size of luma plane [in bytes]
+  long long file_size;        //!< size of regular input file, 0 if unknown
+  long long data_offset;      //!< file offset of first frame (after Y4M stream header)
+  unsigned char *map;         //!< file mapping
+  long page_size;
+  long long prefetched;       //!< end of prefetched range
+  long long released;         //!< end of unmapped range
+  int frames;                 //!< number of frames read
+  int y4m;                    //!< !0 if input is a Y4M stream
+  y4m_info_t y4m_info;        //!< Y4M stream parameters
+  long long pos;              //!< file offset of next frame (READER_MMAP, READER_LUMA)
+  int marker_size;            //!< size of FRAME marker without parameters
+  unsigned char pending[16];  //!< bytes consumed while probing raw stream for Y4M signature
+  int pending_size;
+  frame_ring_t *ring;         //!< READER_STREAM read-ahead ring
+} frame_reader_t;
+
+/*! Work-stealing thread pool */
+typedef struct thread_pool thread_pool_t;
+
+/*! Binary stats log columns, stored in this order within each chunk */
+enum {
+  STATS_FRAME = 0,            //!< int32_t, input frame number
+  STATS_DELTA_FRAME,          //!< float
+  STATS_DELTA_EVEN,           //!< float
+  STATS_DELTA_ODD,            //!< float
+  STATS_GAMMA,                //!< float
+  STATS_COMBED_BLOCKS,        //!< int32_t
+  STATS_MATCH,                //!< int8_t, 'c' or 'p'
+  STATS_DROP,                 //!< int8_t
+  STATS_PHASE,                //!< int8_t, -1 if no cadence is locked
+  STATS_ORDER,                //!< int8_t, 't', 'b' or '-'
+  STATS_BLOCK_GAMMA,          //!< float x block_cols x block_rows per frame, if logged
+  STATS_COLUMNS
+};
+
+/*!
+ *  Binary stats log header (little-endian), followed by fixed-size chunks of chunk_frames
+ *  frames: frame k is entry k % chunk_frames of chunk k / chunk_frames, at offset
+ *  header_size + (k / chunk_frames) * chunk_size. Each chunk starts with its number of
+ *  frames (uint32_t) & 4 reserved bytes, followed by the columns of all its entries.
+ */
+typedef struct {
+  char magic[8];              //!< STATS_LOG_MAGIC
+  uint32_t version;           //!< STATS_LOG_VERSION
+  uint32_t header_size;       //!< offset of first chunk [in bytes]
+  uint32_t chunk_frames;      //!< number of entries per chunk
+  uint32_t chunk_size;        //!< chunk size [in bytes]
+  uint32_t width, height;     //!< frame resolution
+  uint32_t block_cols;        //!< number of blocks across, 0 if per-block gamma is not logged
+  uint32_t block_rows;        //!< number of blocks down, 0 if per-block gamma is not logged
+  uint64_t frames;            //!< number of frames logged, 0 if log was not closed
+  uint8_t reserved[16];
+} stats_log_header_t;
+
+/*! Instrumented processing stages */
+enum {
+  STAGE_READ = 0,             //!< reading (or mapping) a frame
+  STAGE_ANALYZE,              //!< luma kernels: frame/field deltas, block map & field signatures
+  STAGE_CLASSIFY,             //!< cadence, sequential test & histograms, in frame order
+  STAGE_LOG,                  //!< text & binary stats log writes
+  STAGE_FRAME,                //!< frame latency, from start of read to end of commit
+  STAGE_TOTAL
+};
+
+/*! Durations of one stage: totals & log-scale histogram, updated atomically */
+typedef struct {
+  uint64_t count;
+  uint64_t total_ns;
+  uint64_t max_ns;
+  uint32_t bins[PROFILE_OCTAVES * PROFILE_BINS_PER_OCTAVE];
+} stage_counter_t;
+
+/*! Per-stage instrumentation */
+typedef struct {
+  timestamp_t start;          //!< time origin
+  stage_counter_t stages[STAGE_TOTAL];
+  int64_t read_start[PROFILE_RING];   //!< start of read of frames in flight [ns], by frame % PROFILE_RING
+} profile_t;
+
+/*! Binary stats log writer */
+typedef struct stats_log stats_log_t;
+
+/*! Thread pool task, called with task index */
+typedef void (*task_func_t) (void *arg, int task);
+
+/*! Frame-parallel pipeline: reader -> N analysis workers -> in-order commit */
+typedef struct {
+  int threads;                //!< number of analysis workers
+  int frame_size;             //!< frame buffer size [in bytes], 0 if reader does not need buffers
+  unsigned char *(*read) (void *arg, unsigned char *buffer, frame_stats_t *stats);   //!< read next frame into buffer & prepare its analysis, called in frame order, returns frame data or NULL at end of input
+  void (*analyze) (void *arg, unsigned char *frame, frame_stats_t *stats);   //!< analyze frame, called concurrently from workers
+  void (*commit) (void *arg, int index, unsigned char *frame, frame_stats_t *stats);   //!< consume results, called in frame order
+  void *arg;                  //!< callbacks argument
+} pipeline_t;
+
 /* 
  * Function prototypes:
  */
@@ -90,6 +412,124 @@ int make_temp_dir (char *final_dir, int bufsize, char *user_temp_dir);
 int min_index (double *x, int n);
 char *basename (char *name);
 char *remove_filename_extension (char* mystr);
+unsigned int get_cpu_asm_type ();
+
+/* implemented in loss_funcs.c */
+int cpu_asm_type (void);
+int asm_type_by_name (const char *name, int *asm_type);
+const loss_funcs_t *get_loss_funcs (int asm_type);
+
+/* implemented in queue.c */
+int queue_init (queue_t *q, int capacity);
+void queue_free (queue_t *q);
+int queue_push (queue_t *q, int value);
+int queue_pop (queue_t *q, int *value);
+void queue_push_wait (queue_t *q, int value);
+int queue_pop_wait (queue_t *q);
+
+/* implemented in frame_reader.c */
+int reader_open (frame_reader_t *rd, const char *name, int mode);
+int reader_set_frame_size (frame_reader_t *rd, int frame_size, int luma_size);
+long long reader_frame_count (frame_reader_t *rd);
+int reader_seek (frame_reader_t *rd, long long frame);
+unsigned char *reader_read (frame_reader_t *rd, unsigned char *buffer);
+void reader_release (frame_reader_t *rd, unsigned char *frame);
+void reader_close (frame_reader_t *rd);
+
+/* implemented in active_area.c */
+int active_area_detect (crop_t *area, const plane_t *plane, const loss_funcs_t *lf, const unsigned char *zeros);
+
+/* implemented in block_map.c */
+int block_map_init (block_map_t *map, res_t *res);
+void block_map_free (block_map_t *map);
+void block_map_sums (const block_map_t *map, delta_sums_t *sums);
+int block_map_combed (const block_map_t *map, float threshold, int max_count);
+void block_map_gamma (const block_map_t *map, float *gamma);
+
+/* implemented in cadence.c */
+int field_sig_init (field_sig_t *sig, res_t *res);
+void field_sig_free (field_sig_t *sig);
+void field_sig_rows (field_sig_t *sig, const plane_t *plane, const loss_funcs_t *lf, int row_begin, int row_end);
+void cadence_init (cadence_t *cd, const loss_funcs_t *lf);
+void cadence_restart (cadence_t *cd);
+void cadence_push (cadence_t *cd, field_sig_t *sig, cadence_result_t *res);
+void cadence_free (cadence_t *cd);
+
+/* implemented in early_exit.c */
+void running_stats_push (running_stats_t *rs, double x);
+void running_stats_merge (running_stats_t *rs, const running_stats_t *other);
+double running_stats_stddev (const running_stats_t *rs);
+void early_exit_init (early_exit_t *ee, double confidence);
+int early_exit_push (early_exit_t *ee, const frame_stats_t *stats);
+
+/* implemented in y4m.c */
+int y4m_parse_header (const char *line, y4m_info_t *info);
+
+/* implemented in histogram.c */
+void histogram_init (histogram_t *h, double lo, double hi);
+void histogram_add (histogram_t *h, double x);
+int histogram_merge (histogram_t *dst, const histogram_t *src);
+uint64_t histogram_count_above (const histogram_t *h, double x);
+double histogram_quantile (const histogram_t *h, double q);
+void scan_hist_init (scan_hist_t *sh);
+void scan_hist_push (scan_hist_t *sh, const frame_stats_t *stats, const cadence_result_t *cr);
+int scan_hist_merge (scan_hist_t *dst, const scan_hist_t *src);
+int scan_hist_classify (const scan_hist_t *sh);
+
+/* implemented in thread_pool.c */
+thread_pool_t *thread_pool_create (int threads);
+void thread_pool_run (thread_pool_t *pool, task_func_t func, void *arg, int num_tasks);
+int thread_pool_size (thread_pool_t *pool);
+void thread_pool_destroy (thread_pool_t *pool);
+
+/* implemented in stats_log.c */
+size_t stats_log_column (const stats_log_header_t *header, int column);
+stats_log_t *stats_log_open (const char *filename, res_t *res, int block_stats);
+void stats_log_push (stats_log_t *log, int frame, const frame_stats_t *stats, const pd_frame_result_t *fr);
+int stats_log_close (stats_log_t *log);
+
+/* implemented in profile.c */
+void profile_init (profile_t *prof);
+int64_t profile_now (profile_t *prof);
+void profile_add (profile_t *prof, int stage, int64_t ns);
+void profile_report (profile_t *prof, int frames, long long luma_bytes, long long read_bytes);
+
+/* implemented in pipeline.c */
+int run_pipeline (pipeline_t *pl);
+
+/* implemented in loss_funcs_c.c */
+int sad_nx8_u8_c (unsigned char *p, unsigned char *q, int pitch, int n);
+int ssd_nx8_u8_c (unsigned char *p, unsigned char *q, int pitch, int n);
+int sad_nx16_u8_c (unsigned char *p, unsigned char *q, int pitch, int n);
+int ssd_nx16_u8_c (unsigned char *p, unsigned char *q, int pitch, int n);
+void ssd2_nx16_u8_c (unsigned char *p, unsigned char *q, unsigned char *r, int pitch, int n, int *ssd_pq, int *ssd_pr);
+uint64_t sad_nx8_u16_c (uint16_t *p, uint16_t *q, int pitch, int n);
+uint64_t ssd_nx8_u16_c (uint16_t *p, uint16_t *q, int pitch, int n);
+uint64_t sad_nx16_u16_c (uint16_t *p, uint16_t *q, int pitch, int n);
+uint64_t ssd_nx16_u16_c (uint16_t *p, uint16_t *q, int pitch, int n);
+void ssd2_nx16_u16_c (uint16_t *p, uint16_t *q, uint16_t *r, int pitch, int n, uint64_t *ssd_pq, uint64_t *ssd_pr);
+void ssd2_row_u8_c (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr);
+void ssd2_row_u16_c (uint16_t *p, uint16_t *q, uint16_t *r, int n, uint64_t *ssd_pq, uint64_t *ssd_pr);
+void ssd2_rows_u8_c (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1);
+void avg_2x2_u8_c (unsigned char *a, unsigned char *b, unsigned char *out, int n);
+
+/* implemented in loss_funcs_sse2.c */
+int sad_nx8_u8_sse2_intrin (unsigned char *p, unsigned char *q, int pitch, int n);
+int ssd_nx8_u8_sse2_intrin (unsigned char *p, unsigned char *q, int pitch, int n);
+int sad_nx16_u8_sse2_intrin (unsigned char *p, unsigned char *q, int pitch, int n);
+int ssd_nx16_u8_sse2_intrin (unsigned char *p, unsigned char *q, int pitch, int n);
+void ssd2_nx16_u8_sse2_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int pitch, int n, int *ssd_pq, int *ssd_pr);
+uint64_t sad_nx8_u16_sse2_intrin (uint16_t *p, uint16_t *q, int pitch, int n);
+uint64_t ssd_nx8_u16_sse2_intrin (uint16_t *p, uint16_t *q, int pitch, int n);
+uint64_t sad_nx16_u16_sse2_intrin (uint16_t *p, uint16_t *q, int pitch, int n);
+uint64_t ssd_nx16_u16_sse2_intrin (uint16_t *p, uint16_t *q, int pitch, int n);
+void ssd2_nx16_u16_sse2_intrin (uint16_t *p, uint16_t *q, uint16_t *r, int pitch, int n, uint64_t *ssd_pq, uint64_t *ssd_pr);
+void ssd2_row_u8_sse2_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr);
+void ssd2_row_u16_sse2_intrin (uint16_t *p, uint16_t *q, uint16_t *r, int n, uint64_t *ssd_pq, uint64_t *ssd_pr);
+void ssd2_rows_u8_sse2_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1);
+void avg_2x2_u8_sse2_intrin (unsigned char *a, unsigned char *b, unsigned char *out, int n);
+
+/* implemented in loss_funcs_avx2.c */
 
 /* Sum of abosulate difference (SAD) of nx8 windown with AVX2 intrinsic functions */
 int sad_nx8_u8_avx2_intrin(unsigned char *p, unsigned char *q, int pitch, int n);  
@@ -103,6 +543,65 @@ int sad_nx16_u8_avx2_intrin(unsigned char *p, unsigned char *q, int pitch, int n
 /* Sum of squared difference (SSD) of nx16 windown with AVX2 intrinsic functions */
 int ssd_nx16_u8_avx2_intrin(unsigned char *p, unsigned char *q, int pitch, int n);  
 
+/* Sums of squared difference (SSD) of nx16 window against two others in one pass, with AVX2 intrinsic functions */
+void ssd2_nx16_u8_avx2_intrin(unsigned char *p, unsigned char *q, unsigned char *r, int pitch, int n, int *ssd_pq, int *ssd_pr);
+
+/* SAD/SSD of 16-bit sample windows with AVX2 intrinsic functions, 64-bit sums */
+uint64_t sad_nx8_u16_avx2_intrin (uint16_t *p, uint16_t *q, int pitch, int n);
+uint64_t ssd_nx8_u16_avx2_intrin (uint16_t *p, uint16_t *q, int pitch, int n);
+uint64_t sad_nx16_u16_avx2_intrin (uint16_t *p, uint16_t *q, int pitch, int n);
+uint64_t ssd_nx16_u16_avx2_intrin (uint16_t *p, uint16_t *q, int pitch, int n);
+void ssd2_nx16_u16_avx2_intrin (uint16_t *p, uint16_t *q, uint16_t *r, int pitch, int n, uint64_t *ssd_pq, uint64_t *ssd_pr);
+
+/* Sums of squared difference of whole rows against two others, tail masked within the row, with AVX2 intrinsic functions */
+void ssd2_row_u8_avx2_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr);
+void ssd2_row_u16_avx2_intrin (uint16_t *p, uint16_t *q, uint16_t *r, int n, uint64_t *ssd_pq, uint64_t *ssd_pr);
+
+/* Per-block sums of squared difference of a row of statistics blocks against next rows & field partners, with AVX2 intrinsic functions */
+void ssd2_rows_u8_avx2_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1);
+void ssd2_rows_any_u8_avx2_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1);
+
+/* Downscale two rows by averaging 2x2 pixels with AVX2 intrinsic functions */
+void avg_2x2_u8_avx2_intrin (unsigned char *a, unsigned char *b, unsigned char *out, int n);
+
+/* implemented in loss_funcs_avx512.c */
+
+/* SAD/SSD of contiguous 8-bit sample windows with AVX-512BW intrinsic functions, masked tails */
+int sad_nx8_u8_avx512_intrin (unsigned char *p, unsigned char *q, int pitch, int n);
+int ssd_nx8_u8_avx512_intrin (unsigned char *p, unsigned char *q, int pitch, int n);
+int sad_nx16_u8_avx512_intrin (unsigned char *p, unsigned char *q, int pitch, int n);
+int ssd_nx16_u8_avx512_intrin (unsigned char *p, unsigned char *q, int pitch, int n);
+void ssd2_nx16_u8_avx512_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int pitch, int n, int *ssd_pq, int *ssd_pr);
+
+/* SAD/SSD of contiguous 16-bit sample windows with AVX-512BW intrinsic functions, 64-bit sums */
+uint64_t sad_nx8_u16_avx512_intrin (uint16_t *p, uint16_t *q, int pitch, int n);
+uint64_t ssd_nx8_u16_avx512_intrin (uint16_t *p, uint16_t *q, int pitch, int n);
+uint64_t sad_nx16_u16_avx512_intrin (uint16_t *p, uint16_t *q, int pitch, int n);
+uint64_t ssd_nx16_u16_avx512_intrin (uint16_t *p, uint16_t *q, int pitch, int n);
+void ssd2_nx16_u16_avx512_intrin (uint16_t *p, uint16_t *q, uint16_t *r, int pitch, int n, uint64_t *ssd_pq, uint64_t *ssd_pr);
+
+/* Sums of squared difference of whole rows against two others, masked tail loads, with AVX-512BW intrinsic functions */
+void ssd2_row_u8_avx512_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr);
+void ssd2_row_u16_avx512_intrin (uint16_t *p, uint16_t *q, uint16_t *r, int n, uint64_t *ssd_pq, uint64_t *ssd_pr);
+
+/* Per-block sums of squared difference of a row of statistics blocks against next rows & field partners, masked loads, with AVX-512BW intrinsic functions */
+void ssd2_rows_u8_avx512_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1);
+void ssd2_rows_any_u8_avx512_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1);
+
+/* Downscale two rows by averaging 2x2 pixels with AVX-512BW intrinsic functions */
+void avg_2x2_u8_avx512_intrin (unsigned char *a, unsigned char *b, unsigned char *out, int n);
+
+/* implemented in loss_funcs_avx512vnni.c */
+
+/* SSD of contiguous 8-bit sample windows with AVX-512 VNNI (vpdpwssd) intrinsic functions */
+int ssd_nx8_u8_avx512vnni_intrin (unsigned char *p, unsigned char *q, int pitch, int n);
+int ssd_nx16_u8_avx512vnni_intrin (unsigned char *p, unsigned char *q, int pitch, int n);
+void ssd2_nx16_u8_avx512vnni_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int pitch, int n, int *ssd_pq, int *ssd_pr);
+void ssd2_row_u8_avx512vnni_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr);
+/* Per-block sums of squared difference of a row of statistics blocks against next rows & field partners, masked loads, with AVX-512 VNNI intrinsic functions */
+void ssd2_rows_u8_avx512vnni_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1);
+void ssd2_rows_any_u8_avx512vnni_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1);
+
 
 #ifdef __cplusplus
 }
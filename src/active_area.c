@@ -0,0 +1,118 @@
+/*!
+ *  \file     active_area.c
+ *  \brief    Active area detection: picture inside letterbox & pillarbox bars
+ *
+ *  A row or column is black if its mean luma is at most CROP_BLACK_LEVEL (scaled to
+ *  the bitdepth), like the line sums of common crop detectors, so that noise in
+ *  analog-captured bars does not break detection. Row energies are computed by the SAD
+ *  kernels against a row of zeros, scanning from each edge inward. Column energies are
+ *  summed over every CROP_ROW_STEP-th row of the picture, one 16-pixel kernel block at
+ *  a time, and refined to the column within the first & last non-black blocks.
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pattern_detector.h"
+
+/*! Sum of n samples starting at sample x of row, by kernel blocks of 16 samples, then one by one */
+static uint64_t row_sum (const unsigned char *row, const unsigned char *zeros, int x, int n, int bitdepth, const loss_funcs_t *lf)
+{
+  int k, blocks = n / 16;
+  uint64_t sum;
+
+  if (bitdepth > 8) {
+    const uint16_t *p = (const uint16_t *)row + x;
+    sum = lf->sad_nx16_u16 ((uint16_t *)p, (uint16_t *)zeros, 16, blocks);
+    for (k=blocks*16; k<n; k++) sum += p[k];
+  } else {
+    const unsigned char *p = row + x;
+    sum = (uint64_t)lf->sad_nx16_u8 ((unsigned char *)p, (unsigned char *)zeros, 16, blocks);
+    for (k=blocks*16; k<n; k++) sum += p[k];
+  }
+  return sum;
+}
+
+/*! Sum of column x over rows [top, bottom) sampled every CROP_ROW_STEP rows */
+static uint64_t column_sum (const plane_t *plane, int x, int top, int bottom)
+{
+  int i;
+  uint64_t sum = 0;
+  const unsigned char *row;
+
+  for (i=top; i<bottom; i+=CROP_ROW_STEP) {
+    row = plane->data + (size_t)i*plane->stride;
+    sum += (plane->bitdepth > 8)? ((const uint16_t *)row)[x]: row[x];
+  }
+  return sum;
+}
+
+/*!
+ *  \brief Detect active area of a frame
+ *
+ *  The area starts on an even row & has an even height, so that its fields are the
+ *  fields of the frame. Frames that are black, or whose non-black area is smaller than
+ *  half the frame in either direction (dark scenes) or than 16x4 pixels, give no area.
+ *
+ *  \param[out] area      - active area
+ *  \param[in]  plane     - luma plane
+ *  \param[in]  lf        - kernels
+ *  \param[in]  zeros     - row of plane->width zero samples
+ *
+ *  \returns    0 if area is found, 1 if not, -1 if out of memory
+ */
+int active_area_detect (crop_t *area, const plane_t *plane, const loss_funcs_t *lf, const unsigned char *zeros)
+{
+  const unsigned char *frame = plane->data;
+  int width = plane->width, height = plane->height;
+  int stride = plane->stride, bitdepth = plane->bitdepth;
+  int blocks = width / 16, tail = width % 16;
+  int top, bottom, left, right, c, x, rows;
+  uint64_t level = (uint64_t)CROP_BLACK_LEVEL << (bitdepth - 8);
+  uint64_t *sums;
+
+  /* rows, from top & bottom edges inward: */
+  for (top=0; top<height && row_sum(frame + (size_t)top*stride, zeros, 0, width, bitdepth, lf) <= level * width; top++) ;
+  if (top == height)
+    return 1;
+  for (bottom=height; row_sum(frame + (size_t)(bottom-1)*stride, zeros, 0, width, bitdepth, lf) <= level * width; bottom--) ;
+
+  /* keep field parity: */
+  top = (top + 1) & ~1;
+  bottom = top + ((bottom - top) & ~1);
+  if (2 * (bottom - top) < height || bottom - top < 4)
+    return 1;
+
+  /* column blocks, over sampled rows of the picture: */
+  if ((sums = (uint64_t *) calloc(blocks + 1, sizeof(uint64_t))) == NULL)
+    return -1;
+  for (x=top, rows=0; x<bottom; x+=CROP_ROW_STEP, rows++)
+    for (c=0; c<=blocks; c++)
+      sums[c] += row_sum(frame + (size_t)x*stride, zeros, 16*c, (c < blocks)? 16: tail, bitdepth, lf);
+  for (c=0; c<blocks && sums[c] <= level * 16 * rows; c++) ;
+  left = 16 * c;
+  for (c=blocks; c>=0 && sums[c] <= level * ((c < blocks)? 16: tail) * rows; c--) ;
+  right = (c < blocks)? 16*c + 16: width;
+  free(sums);
+  if (c < 0)
+    return 1;
+
+  /* columns within boundary blocks: */
+  for (; left<right && column_sum(plane, left, top, bottom) <= level * rows; left++) ;
+  for (; right>left && column_sum(plane, right-1, top, bottom) <= level * rows; right--) ;
+  if (2 * (right - left) < width || right - left < 16)
+    return 1;
+
+  area->x = left;
+  area->y = top;
+  area->width = right - left;
+  area->height = bottom - top;
+  return 0;
+}
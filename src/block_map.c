@@ -0,0 +1,113 @@
+/*!
+ *  \file     block_map.c
+ *  \brief    Per-block statistics maps
+ *
+ *  Frames are tiled into blocks of BLOCK_HEIGHT rows x BLOCK_WIDTH pixels, and the
+ *  frame & field row differences of each block are kept in separate arrays (SoA), so
+ *  that reductions over the map touch only the sums they need. Small interlaced
+ *  regions (tickers, picture-in-picture) that are averaged away in whole-frame
+ *  statistics stand out in the map.
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pattern_detector.h"
+
+/*!
+ *  \brief Prepare block map for a frame: size it for resolution & clear sums
+ *
+ *  Storage is kept between frames and only grows when resolution requires it.
+ *
+ *  \returns    0 if success, !0 if out of memory
+ */
+int block_map_init (block_map_t *map, res_t *res)
+{
+  int n;
+  uint64_t *data;
+
+  map->cols = (res->width + BLOCK_WIDTH - 1) / BLOCK_WIDTH;
+  map->rows = (res->height + BLOCK_HEIGHT - 1) / BLOCK_HEIGHT;
+  n = map->cols * map->rows;
+
+  if (n > map->capacity) {
+    if ((data = (uint64_t *) malloc(3 * n * sizeof(uint64_t))) == NULL)
+      return 1;
+    free(map->dd_frame);
+    map->dd_frame = data;
+    map->capacity = n;
+  }
+  map->dd_even = map->dd_frame + map->capacity;
+  map->dd_odd = map->dd_even + map->capacity;
+
+  memset(map->dd_frame, 0, n * sizeof(uint64_t));
+  memset(map->dd_even, 0, n * sizeof(uint64_t));
+  memset(map->dd_odd, 0, n * sizeof(uint64_t));
+  return 0;
+}
+
+/*! Release block map storage */
+void block_map_free (block_map_t *map)
+{
+  free(map->dd_frame);
+  memset(map, 0, sizeof(block_map_t));
+}
+
+/*! Sum block statistics over the whole frame */
+void block_map_sums (const block_map_t *map, delta_sums_t *sums)
+{
+  int i, n = map->cols * map->rows;
+
+  sums->dd_frame = sums->dd_even = sums->dd_odd = 0;
+  for (i=0; i<n; i++) {
+    sums->dd_frame += map->dd_frame[i];
+    sums->dd_even += map->dd_even[i];
+    sums->dd_odd += map->dd_odd[i];
+  }
+}
+
+/*! Gamma of each block, in raster order (0 for flat blocks) */
+void block_map_gamma (const block_map_t *map, float *gamma)
+{
+  int i, n = map->cols * map->rows;
+  uint64_t fields;
+
+  for (i=0; i<n; i++) {
+    fields = map->dd_even[i] + map->dd_odd[i];
+    gamma[i] = fields? (float)((double)map->dd_frame[i] / (2.0 * (double)fields)): 0.0f;
+  }
+}
+
+/*!
+ *  \brief Count combed blocks, stopping early once max_count of them are found
+ *
+ *  A block is combed if its gamma, i.e. its adjacent row difference relative to its
+ *  field row differences, exceeds threshold. Blocks hold as many frame row pairs as
+ *  field row pairs (even + odd), half of them for each field, so the test is done on
+ *  the sums directly: dd_frame > 2 x threshold x (dd_even + dd_odd).
+ *
+ *  Use max_count = 1 for a fast "any block combed" test.
+ *
+ *  \param[in]  map        - block map
+ *  \param[in]  threshold  - block gamma threshold
+ *  \param[in]  max_count  - max number of combed blocks to look for
+ *
+ *  \returns    number of combed blocks found, up to max_count
+ */
+int block_map_combed (const block_map_t *map, float threshold, int max_count)
+{
+  int i, count = 0, n = map->cols * map->rows;
+  double t = 2.0 * threshold;
+
+  for (i=0; i<n && count<max_count; i++)
+    if ((double)map->dd_frame[i] > t * (double)(map->dd_even[i] + map->dd_odd[i]))
+      count ++;
+  return count;
+}
@@ -0,0 +1,233 @@
+/*!
+ *  \file     cadence.c
+ *  \brief    Telecine cadence detection & field matching
+ *
+ *  Each field of a frame is summarized once, while the frame is analyzed, into a
+ *  signature: the field downscaled by averaging 2x2 pixels (2 field rows x 2 columns).
+ *  Signatures of the previous frame are kept in a sliding window and reused to match
+ *  fields across consecutive frames:
+ *
+ *    c-match  - first field vs second field of the same frame
+ *    p-match  - first field vs second field of the previous frame
+ *
+ *  3:2 pulldown (AA BB BC CD DD) shows the match pattern c c p p c. The cadence phase
+ *  is locked when exactly one alignment of that pattern agrees with all decisions in
+ *  the window; a decision contradicting the locked phase is reported as a break. With
+ *  a locked phase, every frame gets an IVTC decision: its match, and whether it is the
+ *  duplicate to drop after field matching. Field order is voted by comparing fields
+ *  with the opposite-parity fields of the previous frame in both temporal orders.
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pattern_detector.h"
+
+/* expected matches of frames AA BB BC CD DD in a 3:2 pulldown cycle */
+static const char cadence_pattern[CADENCE_CYCLE] = {'c', 'c', 'p', 'p', 'c'};
+
+#define DROP_POSITION   2     //!< cycle position of frame duplicating its predecessor after p-match
+
+/*!
+ *  \brief Prepare field signatures for a frame of given resolution
+ *
+ *  Storage is kept between frames and only grows when resolution requires it.
+ *
+ *  \returns    0 if success, !0 if out of memory
+ */
+int field_sig_init (field_sig_t *sig, res_t *res)
+{
+  int n;
+  unsigned char *data;
+
+  sig->width = res->width / 2;
+  sig->height = res->height / 4;
+  n = sig->width * sig->height;
+
+  if (n > sig->capacity) {
+    if ((data = (unsigned char *) malloc(2 * n)) == NULL)
+      return 1;
+    free(sig->top);
+    sig->top = data;
+    sig->capacity = n;
+  }
+  sig->bottom = sig->top + sig->capacity;
+  return 0;
+}
+
+/*! Release field signatures storage */
+void field_sig_free (field_sig_t *sig)
+{
+  free(sig->top);
+  memset(sig, 0, sizeof(field_sig_t));
+}
+
+/*!
+ *  \brief Compute signature rows from frame rows [row_begin, row_end)
+ *
+ *  Signature row j is computed from frame rows 4j..4j+3 (rows 4j, 4j+2 for the top field
+ *  & 4j+1, 4j+3 for the bottom one), for the rows j with 4j in [row_begin, row_end), so
+ *  that adjacent row ranges compute each signature row once. High-bitdepth samples are
+ *  scaled down to 8 bits.
+ *
+ *  \param[out] sig        - field signatures
+ *  \param[in]  plane      - luma plane of frame
+ *  \param[in]  lf         - kernels (downscaling of 8-bit rows)
+ *  \param[in]  row_begin  - first row
+ *  \param[in]  row_end    - last row + 1
+ */
+void field_sig_rows (field_sig_t *sig, const plane_t *plane, const loss_funcs_t *lf, int row_begin, int row_end)
+{
+  int j, x, f, stride = plane->stride, shift = plane->bitdepth - 8;
+  unsigned char *row, *out;
+
+  for (j=(row_begin+3)/4; j<sig->height && 4*j<row_end; j++) {
+    for (f=0; f<2; f++) {
+      out = (f? sig->bottom: sig->top) + (size_t)j*sig->width;
+      row = plane->data + (size_t)(4*j + f)*stride;
+      if (plane->bitdepth > 8) {
+        uint16_t *a = (uint16_t *)row;
+        uint16_t *b = (uint16_t *)(row + 2*stride);
+        for (x=0; x<sig->width; x++)
+          out[x] = (unsigned char)min(255, ((a[2*x] + a[2*x+1] + b[2*x] + b[2*x+1] + 2) >> 2) >> shift);
+      } else {
+        lf->avg_2x2_u8 (row, row + 2*stride, out, sig->width);
+      }
+    }
+  }
+}
+
+/*! SAD between two signatures, treated as one contiguous array of 16-byte blocks */
+static uint64_t sig_sad (unsigned char *p, unsigned char *q, int size, const loss_funcs_t *lf)
+{
+  int j, n = size / 16;
+  uint64_t sad = lf->sad_nx16_u8 (p, q, 16, n);
+  for (j=n*16; j<size; j++)
+    sad += abs(p[j] - q[j]);
+  return sad;
+}
+
+/*! Initialize cadence detector */
+void cadence_init (cadence_t *cd, const loss_funcs_t *lf)
+{
+  memset(cd, 0, sizeof(cadence_t));
+  cd->lf = lf;
+  cd->phase = -1;
+}
+
+/*! Release cadence detector */
+void cadence_free (cadence_t *cd)
+{
+  field_sig_free(&cd->prev);
+}
+
+/*! Start a new run of consecutive frames: the next frame is not matched against the previous one */
+void cadence_restart (cadence_t *cd)
+{
+  cd->frames = 0;
+  cd->phase = -1;
+}
+
+/*! Number of alignments with no contradicting decision in window, best one returned in *phase */
+static int consistent_phases (cadence_t *cd, int *phase)
+{
+  int k, i, f, found = 0;
+  char m;
+
+  *phase = -1;
+  for (f=0; f<CADENCE_CYCLE; f++) {
+    for (i=0; i<CADENCE_WINDOW; i++) {
+      k = cd->frames - 1 - i;
+      m = cd->window[k % CADENCE_WINDOW];
+      if (m != '?' && m != cadence_pattern[(k + f) % CADENCE_CYCLE]) break;
+    }
+    if (i == CADENCE_WINDOW) {
+      found ++;
+      *phase = f;
+    }
+  }
+  return found;
+}
+
+/*!
+ *  \brief Match fields of next frame against previous frame & update cadence
+ *
+ *  Must be called in frame order. Signatures are taken over by the detector and sig
+ *  receives the storage of the previous frame signatures, for reuse.
+ *
+ *  \param[in]  cd      - cadence detector
+ *  \param[in]  sig     - field signatures of frame
+ *  \param[out] res     - field matching decision for frame
+ */
+void cadence_push (cadence_t *cd, field_sig_t *sig, cadence_result_t *res)
+{
+  field_sig_t tmp;
+  uint64_t sad_c, sad_p, tff_p, bff_p;
+  unsigned char *first, *second, *prev_second;
+  int size = sig->width * sig->height, locked = cd->phase, f, pos;
+  char m = '?';
+
+  res->match = 'c';
+  res->drop = 0;
+  res->phase = -1;
+  res->order = SCAN_UNKNOWN;
+  res->compared = 0;
+  res->order_metric = 0;
+
+  if (cd->frames > 0 && cd->prev.width == sig->width && cd->prev.height == sig->height && size > 0) {
+    /* field order vote: fields are closer in time to the previous field of opposite parity */
+    tff_p = sig_sad(sig->top, cd->prev.bottom, size, cd->lf);
+    bff_p = sig_sad(sig->bottom, cd->prev.top, size, cd->lf);
+    res->compared = 1;
+    if (tff_p + bff_p > 0)
+      res->order_metric = (float)(((double)bff_p - (double)tff_p) / ((double)bff_p + (double)tff_p));
+    if (min(tff_p, bff_p) < ORDER_RATIO * max(tff_p, bff_p)) {
+      res->order = (tff_p < bff_p)? SCAN_INTERLACE_TFF: SCAN_INTERLACE_BFF;
+      if (tff_p < bff_p) cd->tff_votes ++;
+      else               cd->bff_votes ++;
+    }
+
+    /* c/p field matching, keeping the first field: */
+    first = (cd->bff_votes > cd->tff_votes)? sig->bottom: sig->top;
+    second = (cd->bff_votes > cd->tff_votes)? sig->top: sig->bottom;
+    prev_second = (cd->bff_votes > cd->tff_votes)? cd->prev.top: cd->prev.bottom;
+    sad_c = sig_sad(first, second, size, cd->lf);
+    sad_p = sig_sad(first, prev_second, size, cd->lf);
+    if (min(sad_c, sad_p) < MATCH_RATIO * max(sad_c, sad_p))
+      m = (sad_p < sad_c)? 'p': 'c';
+  }
+  cd->window[cd->frames % CADENCE_WINDOW] = m;
+  cd->frames ++;
+
+  /* lock on cadence if exactly one phase agrees with the whole window: */
+  if (cd->frames >= CADENCE_WINDOW) {
+    if (consistent_phases(cd, &f) != 1) f = -1;
+    if (locked >= 0 && f != locked)
+      cd->breaks ++;
+    cd->phase = f;
+  }
+
+  /* IVTC decision: */
+  if (cd->phase >= 0) {
+    pos = (cd->frames - 1 + cd->phase) % CADENCE_CYCLE;
+    res->phase = pos;
+    res->match = cadence_pattern[pos];
+    res->drop = (pos == DROP_POSITION);
+    cd->locked_frames ++;
+    cd->drops += res->drop;
+  } else if (m != '?') {
+    res->match = m;
+  }
+
+  /* slide window: keep signatures of this frame, hand storage of the previous one back */
+  tmp = cd->prev;
+  cd->prev = *sig;
+  *sig = tmp;
+}
@@ -0,0 +1,114 @@
+/*!
+ *  \file     early_exit.c
+ *  \brief    Confidence-based early termination of the scan
+ *
+ *  Each frame is a Bernoulli observation: combed (gamma above COMB_GAMMA_THRESHOLD)
+ *  or clean. Wald's sequential probability ratio test weighs the combed-frame rate
+ *  expected from progressive content (EARLY_EXIT_P_PROGRESSIVE) against the rate
+ *  expected from interlaced or telecined content (EARLY_EXIT_P_COMBED):
+ *
+ *    llr += combed? log(p1/p0): log((1-p1)/(1-p0))
+ *
+ *  and a class is accepted when llr crosses log(c/(1-c)) (or its negative) for a
+ *  confidence bound c, i.e. error rates of 1-c for both classes. The ratio is kept
+ *  within the thresholds, so that a change of content late in the window can still
+ *  pull it back, and the decision is only taken after it held for EARLY_EXIT_WINDOW
+ *  frames. Flat frames, whose field deltas are too small to show combing, are not
+ *  counted as observations.
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pattern_detector.h"
+
+/*! Add sample to running mean & variance (Welford) */
+void running_stats_push (running_stats_t *rs, double x)
+{
+  double d = x - rs->mean;
+  rs->n ++;
+  rs->mean += d / rs->n;
+  rs->m2 += d * (x - rs->mean);
+}
+
+/*! Add samples of another running stats (Chan et al.) */
+void running_stats_merge (running_stats_t *rs, const running_stats_t *other)
+{
+  int n = rs->n + other->n;
+  double d = other->mean - rs->mean;
+
+  if (other->n == 0) return;
+  rs->mean += d * other->n / n;
+  rs->m2 += other->m2 + d * d * rs->n * other->n / n;
+  rs->n = n;
+}
+
+/*! Standard deviation of samples pushed so far */
+double running_stats_stddev (const running_stats_t *rs)
+{
+  return (rs->n > 1)? sqrt(rs->m2 / (rs->n - 1)): 0.0;
+}
+
+/*!
+ *  \brief Initialize early termination test
+ *
+ *  \param[in]  ee          - test state
+ *  \param[in]  confidence  - confidence required to stop, in (0.5, 1)
+ */
+void early_exit_init (early_exit_t *ee, double confidence)
+{
+  memset(ee, 0, sizeof(early_exit_t));
+  ee->confidence = confidence;
+  ee->upper = log(confidence / (1.0 - confidence));
+  ee->lower = -ee->upper;
+}
+
+/*!
+ *  \brief Update test with statistics of next frame
+ *
+ *  Must be called in frame order.
+ *
+ *  \param[in]  ee      - test state
+ *  \param[in]  stats   - frame statistics
+ *
+ *  \returns    !0 once the scan can be stopped (ee->verdict is set)
+ */
+int early_exit_push (early_exit_t *ee, const frame_stats_t *stats)
+{
+  double p0 = EARLY_EXIT_P_PROGRESSIVE, p1 = EARLY_EXIT_P_COMBED;
+  int combed;
+
+  ee->frames ++;
+  running_stats_push(&ee->gamma, stats->gamma);
+  running_stats_push(&ee->delta_even, stats->delta_even);
+  running_stats_push(&ee->delta_odd, stats->delta_odd);
+  if (ee->verdict != 0)
+    return 1;
+
+  /* flat frames tell nothing about combing: */
+  if (stats->delta_even + stats->delta_odd < FLAT_FIELD_DELTA)
+    return 0;
+  combed = stats->gamma > COMB_GAMMA_THRESHOLD;
+  ee->observed ++;
+  ee->combed += combed;
+  ee->llr += combed? log(p1 / p0): log((1.0 - p1) / (1.0 - p0));
+  ee->llr = max(ee->lower, min(ee->upper, ee->llr));
+
+  /* a class is armed when its threshold is reached, & disarmed if llr falls back half way: */
+  if (ee->llr >= ee->upper)      ee->side = 1;
+  else if (ee->llr <= ee->lower) ee->side = -1;
+  if (ee->side * ee->llr < ee->upper / 2) {
+    ee->side = 0;
+    ee->stable = 0;
+  }
+  if (ee->side != 0 && ++ee->stable >= EARLY_EXIT_WINDOW)
+    ee->verdict = ee->side;
+  return ee->verdict != 0;
+}
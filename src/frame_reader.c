@@ -0,0 +1,574 @@
+/*!
+ *  \file     frame_reader.c
+ *  \brief    Input frame readers
+ *
+ *  READER_STDIO  - frames are fread() into caller's buffer
+ *  READER_MMAP   - file is memory-mapped and frames are returned in place (zero-copy);
+ *                  pages ahead of the cursor are prefetched with madvise(), and pages
+ *                  behind the oldest frame still in use are unmapped
+ *  READER_LUMA   - only the luma plane of each frame is pread() into caller's buffer;
+ *                  kernel readahead is disabled so that chroma is not pulled into the
+ *                  page cache, and luma ranges ahead of the cursor are prefetched instead,
+ *                  coalesced into a single range when chroma gaps between them are small
+ *  READER_STREAM - non-seekable inputs (stdin, pipes, FIFOs): a reader thread fills a fixed
+ *                  ring of frame buffers ahead of the consumer, and frames are returned in
+ *                  place until released; the input is read unbuffered, with poll() on it and
+ *                  on a wake pipe, so that closing the reader stops the thread at once even
+ *                  if the producer is alive but idle
+ *
+ *  Both raw planar files and Y4M streams are supported. Y4M stream headers are parsed
+ *  when the file is opened, and per-frame FRAME markers are skipped while reading.
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <errno.h>
+#else
+#include <io.h>
+#include <fcntl.h>
+#define fseeko _fseeki64
+#endif
+
+#include <pthread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pattern_detector.h"
+
+#define READAHEAD_BYTES   (32 << 20)     //!< mmap / luma readahead window
+#define COALESCE_GAP      (256 << 10)    //!< max chroma gap [in bytes] prefetched together with surrounding luma
+#define END_OF_STREAM     -1             //!< ring queue marker sent after the last frame
+
+/*! Ring of frame buffers filled by stream reader thread */
+struct frame_ring {
+  unsigned char *buffers;     //!< STREAM_RING_FRAMES frames
+  queue_t free_q;             //!< buffers available to reader thread
+  queue_t full_q;             //!< buffers holding frames, in stream order
+  pthread_t thread;
+  int started;
+  int stop;                   //!< set by reader_close() to stop reader thread (atomic)
+#ifndef _MSC_VER
+  int wake[2];                //!< pipe whose write end is closed by reader_close() to wake reader thread
+#endif
+  int eof;                    //!< end of stream reached by consumer
+  long long read;             //!< number of frames returned to consumer (atomic)
+  long long released;         //!< number of frames released by consumer
+};
+
+#ifndef _MSC_VER
+/*! pread() exactly n bytes, return 0 if success */
+static int pread_full (int fd, unsigned char *buf, size_t n, off_t offset)
+{
+  ssize_t r;
+  while (n > 0) {
+    if ((r = pread(fd, buf, n, offset)) <= 0)
+      return 1;
+    buf += r; offset += r; n -= r;
+  }
+  return 0;
+}
+
+/*! Prefetch luma planes of frames starting at given offset */
+static void luma_readahead (frame_reader_t *rd, long long offset)
+{
+  long long stride = rd->frame_size + rd->marker_size;
+  long long end = min(rd->file_size, offset + max(READAHEAD_BYTES, stride));
+
+  if (rd->frame_size - rd->luma_size <= COALESCE_GAP) {
+    /* small gaps: one large request is cheaper than skipping them */
+    posix_fadvise(rd->fd, offset, end - offset, POSIX_FADV_WILLNEED);
+  } else {
+    for (; offset < end; offset += stride)
+      posix_fadvise(rd->fd, offset, rd->marker_size + rd->luma_size, POSIX_FADV_WILLNEED);
+  }
+  rd->prefetched = end;
+}
+#endif
+
+/*!
+ *  \brief Length of Y4M FRAME marker line at the start of buffer, 0 if not a valid marker
+ */
+static int y4m_marker_length (unsigned char *buf, long long len)
+{
+  int i;
+  if (len < 6 || memcmp(buf, "FRAME", 5)) return 0;
+  for (i=5; i<len && i<STRLEN; i++)
+    if (buf[i] == '\n') return i + 1;
+  return 0;
+}
+
+/*!
+ *  \brief Read Y4M stream header or, for raw files, keep the bytes read while probing for it
+ *
+ *  \returns    0 if success, !0 if Y4M header is invalid
+ */
+static int probe_y4m (frame_reader_t *rd)
+{
+  char line[STRLEN];
+  int c, n = 0;
+
+#ifndef _MSC_VER
+  if (rd->fd >= 0) {
+    /* read header line in place: */
+    long long len = min(rd->file_size, STRLEN - 1);
+    if (rd->map) memcpy(line, rd->map, len);
+    else if (pread_full(rd->fd, (unsigned char *)line, len, 0)) return 1;
+    line[len] = 0;
+    if (len < 9 || memcmp(line, Y4M_SIGNATURE, 9))
+      return 0;
+    if (strchr(line, '\n') == NULL) return 1;
+    *strchr(line, '\n') = 0;
+    rd->y4m = 1;
+    rd->pos = rd->data_offset = strlen(line) + 1;
+    return y4m_parse_header(line, &rd->y4m_info);
+  }
+#endif
+
+  /* stream: bytes consumed while probing go to the first raw frame */
+  while (n < 9 && (c = getc(rd->file)) != EOF)
+    line[n++] = (char)c;
+  if (n < 9 || memcmp(line, Y4M_SIGNATURE, 9)) {
+    memcpy(rd->pending, line, n);
+    rd->pending_size = n;
+    return 0;
+  }
+  while ((c = getc(rd->file)) != EOF && c != '\n' && n < STRLEN - 1)
+    line[n++] = (char)c;
+  line[n] = 0;
+  if (c != '\n') return 1;
+  rd->y4m = 1;
+  rd->data_offset = n + 1;
+  return y4m_parse_header(line, &rd->y4m_info);
+}
+
+/*!
+ *  \brief Open input file and parse Y4M stream header if present
+ *
+ *  Standard input ("-") and other inputs that are not regular files (pipes, FIFOs,
+ *  devices) are opened with READER_STREAM instead; rd->mode reports the mode in use.
+ *
+ *  \param[out] rd          - reader
+ *  \param[in]  name        - file name, or "-" for standard input
+ *  \param[in]  mode        - READER_STDIO, READER_MMAP or READER_LUMA
+ *
+ *  \returns    0 if success, !0 if file cannot be opened or Y4M header is invalid
+ */
+int reader_open (frame_reader_t *rd, const char *name, int mode)
+{
+#ifndef _MSC_VER
+  struct stat st;
+#endif
+
+  memset(rd, 0, sizeof(frame_reader_t));
+  rd->mode = mode;
+  rd->fd = -1;
+
+  if (!strcmp(name, "-")) {
+#ifdef _MSC_VER
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    rd->mode = READER_STREAM;
+    rd->file = stdin;
+  }
+
+#ifndef _MSC_VER
+  if (rd->mode == READER_MMAP || rd->mode == READER_LUMA) {
+    if ((rd->fd = open(name, O_RDONLY)) < 0)
+      return 1;
+    if (fstat(rd->fd, &st) || !S_ISREG(st.st_mode) || st.st_size == 0) {
+      close(rd->fd);
+      rd->fd = -1;
+      rd->mode = READER_STDIO;
+    } else {
+      rd->file_size = st.st_size;
+    }
+  }
+
+  if (rd->mode == READER_MMAP) {
+    rd->map = (unsigned char *) mmap(NULL, rd->file_size, PROT_READ, MAP_PRIVATE, rd->fd, 0);
+    if (rd->map == MAP_FAILED) {
+      rd->map = NULL;
+      close(rd->fd);
+      return 1;
+    }
+    rd->page_size = sysconf(_SC_PAGESIZE);
+    madvise(rd->map, rd->file_size, MADV_SEQUENTIAL);
+  }
+
+  if (rd->mode == READER_LUMA)
+    posix_fadvise(rd->fd, 0, 0, POSIX_FADV_RANDOM);
+#else
+  if (rd->mode != READER_STREAM) rd->mode = READER_STDIO;
+#endif
+
+  if (rd->mode == READER_STDIO) {
+    if ((rd->file = fopen(name, "rb")) == NULL)
+      return 1;
+#ifndef _MSC_VER
+    if (fstat(fileno(rd->file), &st) == 0 && !S_ISREG(st.st_mode))
+      rd->mode = READER_STREAM;
+    else
+      rd->file_size = st.st_size;
+#endif
+  }
+
+#ifndef _MSC_VER
+  /* stream frames are read() by the reader thread, so stdio must not buffer input ahead of it: */
+  if (rd->mode == READER_STREAM)
+    setvbuf(rd->file, NULL, _IONBF, 0);
+#endif
+
+  if (probe_y4m(rd)) {
+    reader_close(rd);
+    return 1;
+  }
+  return 0;
+}
+
+#ifndef _MSC_VER
+/*! read() exactly n bytes from stream input on reader thread, return 0 if success, !0 at end of input or when woken by reader_close() */
+static int stream_read (frame_reader_t *rd, unsigned char *buf, size_t n)
+{
+  struct pollfd fds[2];
+  ssize_t r;
+
+  fds[0].fd = fileno(rd->file);
+  fds[0].events = POLLIN;
+  fds[1].fd = rd->ring->wake[0];
+  fds[1].events = POLLIN;
+  while (n > 0) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      return 1;
+    }
+    if (fds[1].revents)
+      return 1;
+    if ((r = read(fds[0].fd, buf, n)) <= 0) {
+      if (r < 0 && errno == EINTR) continue;
+      return 1;
+    }
+    buf += r; n -= r;
+  }
+  return 0;
+}
+#endif
+
+/*! Read exactly n bytes of input, return 0 if success */
+static int read_bytes (frame_reader_t *rd, unsigned char *buf, size_t n)
+{
+#ifndef _MSC_VER
+  if (rd->mode == READER_STREAM)
+    return stream_read(rd, buf, n);
+#endif
+  return (fread (buf, n, 1, rd->file) != 1)? 1: 0;
+}
+
+/*! fread() next frame, skipping Y4M FRAME marker; return 0 if success */
+static int stdio_read_frame (frame_reader_t *rd, unsigned char *buffer)
+{
+  unsigned char marker[STRLEN];
+  int n;
+
+  if (rd->y4m) {
+    /* skip FRAME marker line: */
+    for (n=0; n<STRLEN; n++) {
+      if (read_bytes(rd, marker + n, 1)) return 1;
+      if (marker[n] == '\n') break;
+    }
+    if (n == STRLEN || n < 5 || memcmp(marker, "FRAME", 5))
+      return 1;
+  }
+
+  /* bytes consumed while probing for Y4M signature: */
+  n = rd->pending_size;
+  if (n > 0) {
+    memcpy(buffer, rd->pending, n);
+    rd->pending_size = 0;
+  }
+  return read_bytes(rd, buffer + n, rd->frame_size - n);
+}
+
+/*! Stream reader thread: fill free ring buffers with frames */
+static void *stream_thread (void *arg)
+{
+  frame_reader_t *rd = (frame_reader_t *) arg;
+  frame_ring_t *ring = rd->ring;
+  int b;
+
+  while ((b = queue_pop_wait(&ring->free_q)) != END_OF_STREAM && !__atomic_load_n(&ring->stop, __ATOMIC_ACQUIRE)) {
+    if (stdio_read_frame(rd, ring->buffers + (size_t)b * rd->frame_size))
+      break;
+    queue_push_wait(&ring->full_q, b);
+  }
+  queue_push_wait(&ring->full_q, END_OF_STREAM);
+  return NULL;
+}
+
+/*! Allocate frame ring & start stream reader thread, return 0 if success */
+static int stream_start (frame_reader_t *rd)
+{
+  frame_ring_t *ring;
+  int b;
+
+  if ((ring = rd->ring = (frame_ring_t *) calloc(1, sizeof(frame_ring_t))) == NULL)
+    return 1;
+#ifndef _MSC_VER
+  ring->wake[0] = ring->wake[1] = -1;
+  if (pipe(ring->wake))
+    return 1;
+#endif
+  if ((ring->buffers = (unsigned char *) malloc((size_t)STREAM_RING_FRAMES * rd->frame_size)) == NULL)
+    return 1;
+  if (queue_init(&ring->free_q, STREAM_RING_FRAMES + 1) || queue_init(&ring->full_q, STREAM_RING_FRAMES + 1))
+    return 1;
+  for (b=0; b<STREAM_RING_FRAMES; b++)
+    queue_push(&ring->free_q, b);
+  if (pthread_create(&ring->thread, NULL, stream_thread, rd))
+    return 1;
+  ring->started = 1;
+  return 0;
+}
+
+/*!
+ *  \brief Set size of frames stored in the input
+ *
+ *  \param[in]  rd          - reader
+ *  \param[in]  frame_size  - size of frame [in bytes]
+ *  \param[in]  luma_size   - size of luma plane at the start of each frame [in bytes]
+ *
+ *  \returns    0 if success, !0 if READER_STREAM ring cannot be allocated or started
+ */
+int reader_set_frame_size (frame_reader_t *rd, int frame_size, int luma_size)
+{
+  rd->frame_size = frame_size;
+  rd->luma_size = luma_size;
+  rd->marker_size = rd->y4m? 6: 0;    // "FRAME\n"
+
+  /* streams are read ahead by a separate thread: */
+  if (rd->mode == READER_STREAM && rd->ring == NULL)
+    return stream_start(rd);
+  return 0;
+}
+
+/*!
+ *  \brief Number of frames in input, computed from file size
+ *
+ *  \returns    number of whole frames, or -1 if input is not a regular file
+ */
+long long reader_frame_count (frame_reader_t *rd)
+{
+  long long stride = rd->frame_size + rd->marker_size;
+  if (rd->mode == READER_STREAM || rd->file_size <= 0 || stride <= 0)
+    return -1;
+  return (rd->file_size - rd->data_offset) / stride;
+}
+
+/*!
+ *  \brief Seek to given frame, so that it is returned by the next reader_read()
+ *
+ *  Frame offsets are computed from the fixed frame size (Y4M FRAME markers are assumed
+ *  to have no parameters). Memory-mapped input can only be sought forward, as pages of
+ *  released frames are unmapped.
+ *
+ *  \param[in]  rd      - reader
+ *  \param[in]  frame   - frame index
+ *
+ *  \returns    0 if success, !0 if input is not seekable or frame is out of range
+ */
+int reader_seek (frame_reader_t *rd, long long frame)
+{
+  long long offset = rd->data_offset + frame * (rd->frame_size + rd->marker_size);
+
+  if (rd->mode == READER_STREAM || frame < 0 || frame >= reader_frame_count(rd))
+    return 1;
+  if (rd->mode == READER_MMAP || rd->mode == READER_LUMA) {
+    if (rd->mode == READER_MMAP && offset < rd->released)
+      return 1;
+    rd->pos = offset;
+    return 0;
+  }
+
+  /* bytes read while probing belong to frame 0 and are read again: */
+  rd->pending_size = 0;
+  return fseeko(rd->file, offset, SEEK_SET)? 1: 0;
+}
+
+/*!
+ *  \brief Read next frame
+ *
+ *  \param[in]  rd      - reader
+ *  \param[in]  buffer  - frame buffer (not used by READER_MMAP & READER_STREAM, luma_size bytes for READER_LUMA)
+ *
+ *  \returns    pointer to frame data, or NULL at end of input
+ */
+unsigned char *reader_read (frame_reader_t *rd, unsigned char *buffer)
+{
+  int n;
+#ifndef _MSC_VER
+  unsigned char marker[STRLEN];
+  long long offset, start, ahead;
+  struct iovec iov[2];
+
+  if (rd->mode == READER_MMAP) {
+    offset = rd->pos;
+    if (rd->y4m) {
+      if ((n = y4m_marker_length(rd->map + offset, rd->file_size - offset)) == 0)
+        return NULL;
+      offset += n;
+    }
+    if (offset + rd->frame_size > rd->file_size)
+      return NULL;
+
+    /* prefetch next window when the cursor enters the current one */
+    if (offset + rd->frame_size > rd->prefetched) {
+      ahead = min(rd->file_size, offset + rd->frame_size + READAHEAD_BYTES);
+      start = offset / rd->page_size * rd->page_size;
+      madvise(rd->map + start, ahead - start, MADV_WILLNEED);
+      rd->prefetched = ahead;
+    }
+    rd->pos = offset + rd->frame_size;
+    rd->frames ++;
+    return rd->map + offset;
+  }
+
+  if (rd->mode == READER_LUMA) {
+    offset = rd->pos;
+    if (offset + rd->marker_size + rd->frame_size > rd->file_size)
+      return NULL;
+
+    /* keep at least half of the readahead window ahead of the cursor */
+    if (offset + rd->frame_size > rd->prefetched - READAHEAD_BYTES/2)
+      luma_readahead(rd, max(offset, rd->prefetched));
+
+    if (rd->y4m) {
+      /* read "FRAME\n" marker and luma with one call, re-read if marker has parameters */
+      iov[0].iov_base = marker; iov[0].iov_len = 6;
+      iov[1].iov_base = buffer; iov[1].iov_len = rd->luma_size;
+      if (preadv(rd->fd, iov, 2, offset) != 6 + rd->luma_size || memcmp(marker, "FRAME\n", 6)) {
+        n = (int)min(rd->file_size - offset, STRLEN);
+        if (pread_full(rd->fd, marker, n, offset) || (n = y4m_marker_length(marker, n)) == 0)
+          return NULL;
+        if (offset + n + rd->frame_size > rd->file_size || pread_full(rd->fd, buffer, rd->luma_size, offset + n))
+          return NULL;
+        offset += n;
+      } else {
+        offset += 6;
+      }
+    } else if (pread_full(rd->fd, buffer, rd->luma_size, offset)) {
+      return NULL;
+    }
+    rd->pos = offset + rd->frame_size;
+    rd->frames ++;
+    return buffer;
+  }
+#endif
+
+  if (rd->mode == READER_STREAM) {
+    frame_ring_t *ring = rd->ring;
+    if (ring->eof || (n = queue_pop_wait(&ring->full_q)) == END_OF_STREAM) {
+      ring->eof = 1;
+      return NULL;
+    }
+    /* read by reader_release() on the thread committing frames: */
+    __atomic_store_n(&ring->read, ring->read + 1, __ATOMIC_RELEASE);
+    rd->frames ++;
+    return ring->buffers + (size_t)n * rd->frame_size;
+  }
+
+  if (stdio_read_frame(rd, buffer))
+    return NULL;
+  rd->frames ++;
+  return buffer;
+}
+
+/*!
+ *  \brief Release frame and all frames before it
+ *
+ *  With READER_MMAP, the pages holding only released frames are unmapped, so that
+ *  resident memory stays bounded while scanning large files. With READER_STREAM, ring
+ *  buffers of released frames are handed back to the reader thread.
+ *
+ *  \param[in]  rd     - reader
+ *  \param[in]  frame  - frame data returned by reader_read()
+ */
+void reader_release (frame_reader_t *rd, unsigned char *frame)
+{
+  frame_ring_t *ring = rd->ring;
+#ifndef _MSC_VER
+  long long end;
+#endif
+  long long read;
+  int b;
+
+  if (rd->mode == READER_STREAM) {
+    /* frames are read & released in stream order, so buffers are reused round-robin: */
+    b = (int)((frame - ring->buffers) / rd->frame_size);
+    read = __atomic_load_n(&ring->read, __ATOMIC_ACQUIRE);
+    while (ring->released < read) {
+      queue_push_wait(&ring->free_q, (int)(ring->released++ % STREAM_RING_FRAMES));
+      if ((ring->released - 1) % STREAM_RING_FRAMES == b) break;
+    }
+    return;
+  }
+
+#ifndef _MSC_VER
+
+  if (rd->mode == READER_MMAP) {
+    end = (frame - rd->map + rd->frame_size) / rd->page_size * rd->page_size;
+    if (end - rd->released >= READAHEAD_BYTES) {
+      munmap(rd->map + rd->released, end - rd->released);
+      rd->released = end;
+    }
+  }
+#endif
+}
+
+/*! Close input */
+void reader_close (frame_reader_t *rd)
+{
+  frame_ring_t *ring = rd->ring;
+
+  if (ring != NULL) {
+    if (ring->started) {
+      /* stop reader thread: it may be blocked waiting for a free buffer, or for input */
+      __atomic_store_n(&ring->stop, 1, __ATOMIC_RELEASE);
+#ifndef _MSC_VER
+      close(ring->wake[1]);
+      ring->wake[1] = -1;
+#endif
+      queue_push_wait(&ring->free_q, END_OF_STREAM);
+      pthread_join(ring->thread, NULL);
+    }
+#ifndef _MSC_VER
+    if (ring->wake[0] >= 0) close(ring->wake[0]);
+    if (ring->wake[1] >= 0) close(ring->wake[1]);
+#endif
+    queue_free(&ring->free_q); queue_free(&ring->full_q);
+    free(ring->buffers);
+    free(ring);
+    rd->ring = NULL;
+  }
+#ifndef _MSC_VER
+  if (rd->map != NULL && rd->file_size > rd->released)
+    munmap(rd->map + rd->released, rd->file_size - rd->released);
+  if (rd->fd >= 0) {
+    close(rd->fd);
+    return;
+  }
+#endif
+  if (rd->file && rd->file != stdin) fclose(rd->file);
+}
@@ -0,0 +1,160 @@
+/*!
+ *  \file     histogram.c
+ *  \brief    Streaming histograms & scan type classification
+ *
+ *  Per-frame statistics are accumulated into fixed histograms of BINS counters, so a
+ *  stream of any length is classified in constant memory, without per-frame logs.
+ *  Histograms over the same range are merged by adding counters, e.g. to classify a
+ *  stream analyzed in separate chunks. The scan type is taken from:
+ *
+ *    gamma       - rate of combed frames (gamma above COMB_GAMMA_THRESHOLD), compared
+ *                  with the rate at which progressive (EARLY_EXIT_P_PROGRESSIVE) and
+ *                  combed (EARLY_EXIT_P_COMBED) content are equally likely
+ *    order       - fields closer in top-first vs bottom-first order
+ *
+ *  The relative difference of the field deltas is kept alongside, for diagnostics.
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pattern_detector.h"
+
+#define MAX_GAMMA       (2 * COMB_GAMMA_THRESHOLD)    //!< upper bound of gamma histogram, centered on the threshold
+
+/*! Initialize histogram over [lo, hi) */
+void histogram_init (histogram_t *h, double lo, double hi)
+{
+  memset(h, 0, sizeof(histogram_t));
+  h->min = lo;
+  h->max = hi;
+}
+
+/*! Bin of value, values out of range go to the first or last bin */
+static int histogram_bin (const histogram_t *h, double x)
+{
+  double b = (x - h->min) * BINS / (h->max - h->min);
+  return (b < 0 || b != b)? 0: (b >= BINS)? BINS - 1: (int)b;
+}
+
+/*! Add value to histogram */
+void histogram_add (histogram_t *h, double x)
+{
+  h->bins[histogram_bin(h, x)] ++;
+  h->count ++;
+}
+
+/*!
+ *  \brief Add counters of another histogram
+ *
+ *  \returns    0 if success, 1 if ranges differ
+ */
+int histogram_merge (histogram_t *dst, const histogram_t *src)
+{
+  int i;
+
+  if (dst->min != src->min || dst->max != src->max)
+    return 1;
+  for (i=0; i<BINS; i++)
+    dst->bins[i] += src->bins[i];
+  dst->count += src->count;
+  return 0;
+}
+
+/*! Number of values at or above x, at bin resolution */
+uint64_t histogram_count_above (const histogram_t *h, double x)
+{
+  uint64_t n = 0;
+  int i;
+
+  for (i=histogram_bin(h, x); i<BINS; i++)
+    n += h->bins[i];
+  return n;
+}
+
+/*! Value below which fraction q of values lie, interpolated within bins (min if empty) */
+double histogram_quantile (const histogram_t *h, double q)
+{
+  double target = q * h->count, width = (h->max - h->min) / BINS;
+  uint64_t n = 0;
+  int i;
+
+  for (i=0; i<BINS; i++) {
+    if (h->bins[i] > 0 && n + h->bins[i] >= target)
+      return h->min + width * (i + (target - n) / h->bins[i]);
+    n += h->bins[i];
+  }
+  return (h->count > 0)? h->max: h->min;
+}
+
+/*! Initialize scan histograms */
+void scan_hist_init (scan_hist_t *sh)
+{
+  histogram_init(&sh->gamma, 0, MAX_GAMMA);
+  histogram_init(&sh->field_diff, MIN_FIELD_DIFF, MAX_FIELD_DIFF);
+  histogram_init(&sh->order, -1, 1);
+}
+
+/*!
+ *  \brief Add statistics of next frame
+ *
+ *  \param[in]  sh      - histograms
+ *  \param[in]  stats   - frame statistics
+ *  \param[in]  cr      - field matching result of frame
+ */
+void scan_hist_push (scan_hist_t *sh, const frame_stats_t *stats, const cadence_result_t *cr)
+{
+  double sum = stats->delta_even + stats->delta_odd;
+
+  if (cr->compared)
+    histogram_add(&sh->order, cr->order_metric);
+
+  /* flat frames tell nothing about combing: */
+  if (sum < FLAT_FIELD_DELTA)
+    return;
+  histogram_add(&sh->gamma, stats->gamma);
+  histogram_add(&sh->field_diff, fabs(stats->delta_even - stats->delta_odd) / sum);
+}
+
+/*!
+ *  \brief Add counters of histograms of another stream
+ *
+ *  \returns    0 if success, 1 if ranges differ
+ */
+int scan_hist_merge (scan_hist_t *dst, const scan_hist_t *src)
+{
+  return histogram_merge(&dst->gamma, &src->gamma) || histogram_merge(&dst->field_diff, &src->field_diff)
+      || histogram_merge(&dst->order, &src->order);
+}
+
+/*!
+ *  \brief Classify scan type from histograms
+ *
+ *  \returns    SCAN_PROGRESSIVE, SCAN_INTERLACE_TFF/BFF, or SCAN_UNKNOWN if no frame was observed
+ */
+int scan_hist_classify (const scan_hist_t *sh)
+{
+  double p0 = EARLY_EXIT_P_PROGRESSIVE, p1 = EARLY_EXIT_P_COMBED;
+  double rate, r = (1.0 - ORDER_RATIO) / (1.0 + ORDER_RATIO);
+  uint64_t tff, bff;
+
+  if (sh->gamma.count == 0)
+    return SCAN_UNKNOWN;
+
+  /* combed-frame rate at which the likelihoods of both classes are equal: */
+  rate = log((1.0 - p0) / (1.0 - p1)) / (log(p1 / p0) + log((1.0 - p0) / (1.0 - p1)));
+  if (histogram_count_above(&sh->gamma, COMB_GAMMA_THRESHOLD) < rate * sh->gamma.count)
+    return SCAN_PROGRESSIVE;
+
+  /* frames whose SADs differ by ORDER_RATIO, as for field order votes: */
+  tff = histogram_count_above(&sh->order, r);
+  bff = sh->order.count - histogram_count_above(&sh->order, -r);
+  return (bff > tff)? SCAN_INTERLACE_BFF: SCAN_INTERLACE_TFF;
+}
@@ -0,0 +1,763 @@
+/*!
+ *  \file     libpatterndetect.c
+ *  \brief    Scan pattern detection library: frame analysis & detector context
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "pattern_detector.h"
+
+/*! Detector context */
+struct pd_context {
+  res_t res;
+  int format;
+  int bitdepth;
+  const loss_funcs_t *lf;
+  thread_pool_t *pool;        //!< row band threads, NULL if off
+  cadence_t cadence;          //!< telecine cadence detector, fed in frame order
+  early_exit_t test;          //!< sequential test deciding when to stop
+  scan_hist_t hist;           //!< histograms classifying the scan type
+  int cascade;                //!< !0 if frames are analyzed on decimated rows & columns first
+  int crop_interval;          //!< frames between active area detections, 0 if whole frames are analyzed
+  int chroma;                 //!< !0 if chroma planes are analyzed too
+  int sub_x, sub_y;           //!< chroma subsampling [log2]
+  running_stats_t chroma_gamma[2];  //!< gamma of U & V planes of frames with chroma analyzed
+  int chroma_combed_frames;   //!< number of frames with combed chroma & uncombed luma
+  unsigned char *zeros;       //!< row of zero samples, for row & column energies of active area detection
+  int pushed;                 //!< number of frames pushed by pd_push_frame/pd_push_planes since last reset or restart
+  crop_t area;                //!< active area last detected, guarded by area_lock
+  pthread_mutex_t area_lock;
+  int frames;                 //!< number of frames committed
+  int combed_frames;          //!< number of frames with at least one combed block
+  int escalated_frames;       //!< number of frames analyzed again at full resolution by cascade
+  pd_frame_t *frame;          //!< analysis state used by pd_push_frame()
+};
+
+
+/*! 
+ *  \brief Compute size of an image/frame stored using a given format 
+ */
+int pd_frame_size (int width, int height, int format, int bitdepth)
+{
+  int size = 0;
+
+  /* compute image size based on format: */
+  switch (format)  {
+    case FORMAT_YUV420:   size = height * width * 3/2;  break;
+    case FORMAT_YUV422:   size = height * width * 2;    break;
+    case FORMAT_YUV444:   size = height * width * 3;    break;
+    case FORMAT_YUV400:   size = height * width;        break;
+  }
+
+  /* adjust based on pixel depth: */
+  if (bitdepth > 8)
+    size *= 2; 
+
+  /* return 0 if error, frame size otherwize */
+  return size;
+}
+
+/*! Sub-plane of the samples of plane within area, sharing its memory */
+static plane_t plane_crop(const plane_t *plane, const crop_t *area)
+{
+  plane_t sub = *plane;
+
+  sub.data += (size_t)area->y * plane->stride + (size_t)area->x * ((plane->bitdepth > 8)? 2: 1);
+  sub.width = area->width;
+  sub.height = area->height;
+  return sub;
+}
+
+/*! Number of 16-pixel kernel blocks, pitch pixels apart, fitting in [0, width) */
+static int kernel_blocks(int width, int pitch)
+{
+  return (width >= 16)? (width - 16) / pitch + 1: 0;
+}
+
+/*! Number of columns compared by the cascade coarse pass in each row */
+static int coarse_columns(int width)
+{
+  int j, cols = 0;
+
+  for (j=0; j<width; j+=BLOCK_WIDTH)
+    cols += 16 * kernel_blocks(min(BLOCK_WIDTH, width - j), CASCADE_PITCH);
+  return cols;
+}
+
+/*!
+ * @brief Accumulate squared differences of row p against rows q and r on one kernel block every pitch pixels, per statistics block
+ * 
+ * The row is split into columns of BLOCK_WIDTH pixels, each handled by one fused kernel
+ * call on strided loads, so that per-block sums come out of the same pass, and the
+ * remaining columns are skipped. Used by the cascade coarse pass only: 8-bit rows at
+ * full resolution are compared a block row at a time (see accumulate_deltas()).
+ * 
+ * @param[in] p            row
+ * @param[in] q            next row
+ * @param[in] r            row of same parity below p (NULL if none)
+ * @param[in] width        row length
+ * @param[in] pitch        distance between compared kernel blocks, more than 16
+ * @param[in] lf           loss kernels
+ * @param[in,out] dd_pq    per-block sums of p vs q
+ * @param[in,out] dd_pr    per-block sums of p vs r
+ */
+static void accumulate_row(unsigned char *p, unsigned char *q, unsigned char *r, int width, int pitch, const loss_funcs_t *lf, uint64_t *dd_pq, uint64_t *dd_pr)
+{
+  int c, j, n, ssd_pq, ssd_pr;
+
+  for (c=0, j=0; j<width; c++, j+=BLOCK_WIDTH) {
+    n = kernel_blocks(min(BLOCK_WIDTH, width - j), pitch);
+    if (r != NULL) lf->ssd2_nx16_u8 (p+j, q+j, r+j, pitch, n, &ssd_pq, &ssd_pr);
+    else           ssd_pq = lf->ssd_nx16_u8 (p+j, q+j, pitch, n);
+    dd_pq[c] += ssd_pq;
+    if (r != NULL) dd_pr[c] += ssd_pr;
+  }
+}
+
+/*!
+ * @brief accumulate_row() for rows of 16-bit samples, also at full resolution (pitch 16): row kernels
+ *        cover the columns past the last full kernel block with masked loads, without reading past the row end
+ */
+static void accumulate_row_u16(uint16_t *p, uint16_t *q, uint16_t *r, int width, int pitch, const loss_funcs_t *lf, uint64_t *dd_pq, uint64_t *dd_pr)
+{
+  int c, j, n, end;
+  uint64_t ssd_pq, ssd_pr;
+
+  for (c=0, j=0; j<width; c++, j+=BLOCK_WIDTH) {
+    end = min(j + BLOCK_WIDTH, width);
+    n = kernel_blocks(end - j, pitch);
+    if (pitch == 16)    lf->ssd2_row_u16 (p+j, q+j, (r != NULL)? r+j: q+j, end - j, &ssd_pq, &ssd_pr);
+    else if (r != NULL) lf->ssd2_nx16_u16 (p+j, q+j, r+j, pitch, n, &ssd_pq, &ssd_pr);
+    else                ssd_pq = lf->ssd_nx16_u16 (p+j, q+j, pitch, n);
+    dd_pq[c] += ssd_pq;
+    if (r != NULL) dd_pr[c] += ssd_pr;
+  }
+}
+
+/*!
+ * @brief Accumulate frame and field row differences over rows [row_begin, row_end) in a single sweep
+ * 
+ * Row i is compared against rows i+1 (frame) and i+2 (field of same parity) with one fused
+ * kernel call per block column, so only a window of three rows is kept hot and each row is
+ * fetched from memory once per frame. Sums are accumulated per statistics block; rows
+ * [row_begin, row_end) must cover whole block rows if several sweeps run concurrently.
+ * 
+ * At full resolution, 8-bit rows are compared one block row at a time, so that each
+ * row is loaded once for its three comparisons and sums are reduced once per block.
+ * 
+ * The coarse pass of the cascade only compares the two rows starting every
+ * CASCADE_ROW_STEP rows (each with its next row & field partner), on one kernel block
+ * every CASCADE_PITCH pixels. Blocks keep as many frame row pairs as field row pairs,
+ * so per-block gamma is estimated from the same subset.
+ * 
+ * @param[in] plane        analyzed plane (active area of the frame)
+ * @param[in] lf           loss kernels
+ * @param[in] coarse       !0 for the cascade coarse pass on decimated rows & columns
+ * @param[in] row_begin    first row
+ * @param[in] row_end      last row + 1
+ * @param[in,out] map      per-block squared differences
+ */
+static void accumulate_deltas(const plane_t *plane, const loss_funcs_t *lf, int coarse, int row_begin, int row_end, block_map_t *map)
+{
+  int i, n, blk;
+  int width = plane->width, height = plane->height, stride = plane->stride;
+  int pitch = coarse? CASCADE_PITCH: 16;
+  uint64_t *dd_field;
+  unsigned char *p;
+
+  if (!coarse && plane->bitdepth <= 8) {
+    for (i=row_begin; i<row_end && i<height-1; i+=n) {
+      blk = (i / BLOCK_HEIGHT) * map->cols;
+      n = min(min(BLOCK_HEIGHT - i % BLOCK_HEIGHT, row_end - i), height - 1 - i);
+      lf->ssd2_rows_u8 (plane->data + (size_t)i*stride, stride, width, n, min(n, height - 2 - i), &map->dd_frame[blk],
+                        (i & 1)? &map->dd_odd[blk]: &map->dd_even[blk], (i & 1)? &map->dd_even[blk]: &map->dd_odd[blk]);
+    }
+    return;
+  }
+
+  for (i=row_begin; i<row_end && i<height-1; i++) {
+    if (coarse && (i % CASCADE_ROW_STEP > 1 || i - i % CASCADE_ROW_STEP + 3 >= height))
+      continue;
+    blk = (i / BLOCK_HEIGHT) * map->cols;
+    dd_field = (i & 1)? &map->dd_odd[blk]: &map->dd_even[blk];
+
+    /* last row pair has no field partner */
+    p = plane->data + (size_t)i*stride;
+    if (plane->bitdepth > 8)
+      accumulate_row_u16 ((uint16_t *)p, (uint16_t *)(p + stride), (i < height-2)? (uint16_t *)(p + 2*stride): NULL, width, pitch, lf, &map->dd_frame[blk], dd_field);
+    else
+      accumulate_row (p, p + stride, (i < height-2)? p + 2*stride: NULL, width, pitch, lf, &map->dd_frame[blk], dd_field);
+  }
+}
+
+/*! Row band job: bands cover whole block rows of the active area of every plane, so each band owns its rows of the block maps */
+typedef struct {
+  const plane_t *frame;       //!< luma plane
+  crop_t *area;               //!< active area, rows of which are split into bands
+  int planes;                 //!< number of analyzed planes: luma, then chroma planes if any
+  plane_t area_plane[3];      //!< samples of active area within each plane
+  int sub_y[3];               //!< vertical subsampling of each plane [log2]
+  int coarse[3];              //!< !0 for the coarse pass on each plane
+  block_map_t **map;          //!< per-block statistics of each plane
+  const loss_funcs_t *lf;
+  int band_height;            //!< luma rows per band
+  field_sig_t *sig;
+} band_job_t;
+
+/*!
+ * @brief Accumulate deltas over active area rows [row_begin, row_end) & compute field signatures of the same frame rows, while they are in cache
+ * 
+ * Chroma planes accumulate their rows covering the same luma rows. Signatures cover the
+ * whole frame: the first & last bands also take the rows above & below the active area.
+ */
+static void analyze_rows (band_job_t *job, int row_begin, int row_end)
+{
+  int k;
+
+  /* rows are compared with up to two rows below them, which belong to the next band */
+  for (k=0; k<job->planes; k++)
+    accumulate_deltas(&job->area_plane[k], job->lf, job->coarse[k], row_begin >> job->sub_y[k], row_end >> job->sub_y[k], job->map[k]);
+  if (job->sig != NULL)
+    field_sig_rows(job->sig, job->frame, job->lf, (row_begin > 0)? job->area->y + row_begin: 0,
+                   (row_end < job->area_plane[0].height)? job->area->y + row_end: job->frame->height);
+}
+
+/*! Thread pool task: analyze one band of rows */
+static void band_task (void *arg, int band)
+{
+  band_job_t *job = (band_job_t *) arg;
+  int row_begin = band * job->band_height;
+  analyze_rows(job, row_begin, row_begin + job->band_height);
+}
+
+/*!
+ * @brief Given a frame, calculate frame delta and even/odd field deltas of the active area of each plane in one pass over the frame
+ * 
+ * Squared differences are accumulated per block of BLOCK_HEIGHT x BLOCK_WIDTH samples
+ * of the active area into the block map of each plane, and the plane sums are reduced
+ * from it. If pool is given, the area is split into horizontal bands of whole block rows
+ * (of every plane) that are processed concurrently, each band taking the luma & chroma
+ * rows at the same position. Field signatures of the whole luma plane are computed from
+ * the same rows while they are in cache.
+ * 
+ * @param[in] planes       luma plane, then chroma planes
+ * @param[in] num_planes   number of planes: 1 (luma only) or 3
+ * @param[in] sub_x        horizontal chroma subsampling [log2]
+ * @param[in] sub_y        vertical chroma subsampling [log2]
+ * @param[in] area         active area of luma plane (whole frame if there are no black bars)
+ * @param[in] lf           loss kernels
+ * @param[in] coarse       !0 for the cascade coarse pass on decimated rows & columns
+ * @param[in] pool         thread pool for row bands (can be NULL)
+ * @param[out] maps        per-block statistics of each plane, (re)allocated for its active area
+ * @param[out] sig         field signatures, (re)allocated for frame resolution (NULL to skip them)
+ * @param[out] deltas      frame, even & odd field deltas of each plane
+ * 
+ * @returns 0 if success, !0 if out of memory
+ */
+static int calculate_deltas(const plane_t *planes, int num_planes, int sub_x, int sub_y, crop_t *area, const loss_funcs_t *lf, int coarse,
+                            thread_pool_t *pool, block_map_t **maps, field_sig_t *sig, float deltas[][3])
+{
+  delta_sums_t sums;
+  band_job_t job;
+  res_t res = {planes[0].width, planes[0].height}, area_res;
+  crop_t plane_area;
+  int i, k, unit, bands, frame_pairs, field_pairs;
+  plane_t *p;
+
+  if (sig != NULL && field_sig_init(sig, &res))
+    return 1;
+  for (k=0; k<num_planes; k++) {
+    plane_area = *area;
+    job.sub_y[k] = 0;
+    if (k > 0) {
+      plane_area.x = area->x >> sub_x;
+      plane_area.y = area->y >> sub_y;
+      plane_area.width = ((area->x + area->width) >> sub_x) - plane_area.x;
+      plane_area.height = ((area->y + area->height) >> sub_y) - plane_area.y;
+      job.sub_y[k] = sub_y;
+    }
+    job.area_plane[k] = plane_crop(&planes[k], &plane_area);
+    job.coarse[k] = coarse && plane_area.width >= 16;
+    area_res.width = plane_area.width;
+    area_res.height = plane_area.height;
+    if (block_map_init(maps[k], &area_res))
+      return 1;
+  }
+  job.frame = &planes[0];
+  job.area = area;
+  job.planes = num_planes;
+  job.map = maps;
+  job.lf = lf;
+  job.sig = sig;
+
+  /* a few bands per thread, so that idle workers have something to steal */
+  bands = (pool != NULL)? min(MAX_BANDS, min(4 * (thread_pool_size(pool) + 1), area->height / MIN_BAND_HEIGHT)): 1;
+  unit = (num_planes > 1)? BLOCK_HEIGHT << sub_y: BLOCK_HEIGHT;
+
+  if (bands > 1) {
+    job.band_height = ((area->height + bands - 1) / bands + unit - 1) / unit * unit;
+    bands = (area->height + job.band_height - 1) / job.band_height;
+    thread_pool_run(pool, band_task, &job, bands);
+  } else {
+    for (i=0; i<area->height; i+=unit)
+      analyze_rows(&job, i, i + unit);
+  }
+
+  for (k=0; k<num_planes; k++) {
+    block_map_sums(maps[k], &sums);
+    p = &job.area_plane[k];
+
+    /* number of compared pixel pairs: coarse pass compares 2 frame & 1 even/odd row pairs per row step */
+    if (job.coarse[k]) {
+      field_pairs = ((p->height - 4) / CASCADE_ROW_STEP + 1) * coarse_columns(p->width);
+      frame_pairs = 2 * field_pairs;
+    } else {
+      field_pairs = (p->height/2 -1)*p->width;
+      frame_pairs = (p->height-1)*p->width;
+    }
+    deltas[k][0] = (float)sums.dd_frame / frame_pairs;
+    deltas[k][1] = (float)sums.dd_even / field_pairs;
+    deltas[k][2] = (float)sums.dd_odd / field_pairs;
+  }
+  return 0;
+}
+
+/*!
+ * @brief Check whether coarse statistics leave the frame ambiguous, so that the cascade escalates it
+ * 
+ * Frames are escalated if their gamma is within [CASCADE_GAMMA_LOW, CASCADE_GAMMA_HIGH],
+ * or if a frame that looks progressive has combed blocks (possibly a small interlaced
+ * region). Frames too flat to show combing are never escalated.
+ */
+static int cascade_ambiguous(frame_stats_t *frame)
+{
+  if (frame->delta_even + frame->delta_odd < FLAT_FIELD_DELTA)
+    return 0;
+  if (frame->gamma > CASCADE_GAMMA_HIGH)
+    return 0;
+  return frame->gamma >= CASCADE_GAMMA_LOW || block_map_combed(&frame->blocks, COMB_GAMMA_THRESHOLD, 1) > 0;
+}
+
+/******************************************************* 
+ * 
+ *  Library API: 
+ *
+ *  pd_create()
+ *  pd_analyze_frame()
+ *  pd_commit_frame()
+ *  pd_push_frame()
+ *  pd_get_result()
+ *  pd_merge()
+ *  pd_reset()
+ *  pd_destroy()
+ * 
+ ****/
+
+/*!
+ *  \brief Create detector context
+ *
+ *  \param[in]  params  - video parameters & detector options
+ *
+ *  \returns    context, or NULL if parameters are invalid, out of memory, or band threads cannot be created
+ */
+pd_context_t *pd_create (const pd_params_t *params)
+{
+  pd_context_t *pd;
+  double confidence = (params->confidence > 0)? params->confidence: PD_DEFAULT_CONFIDENCE;
+
+  /* check parameters: */
+  if (params->width <= 0 || params->height < 4 || params->width > MAX_WIDTH || params->height > MAX_HEIGHT || (params->height & 1)
+   || params->bitdepth < 8 || params->bitdepth > 16 || pd_frame_size(params->width, params->height, params->format, params->bitdepth) <= 0
+   || params->asm_type < ASM_AUTO || params->asm_type >= ASM_TYPE_TOTAL || params->band_threads < 0 || params->band_threads > MAX_THREADS
+   || confidence <= 0.5 || confidence >= 1.0)
+    return NULL;
+
+  if ((pd = (pd_context_t *) calloc(1, sizeof(pd_context_t))) == NULL)
+    return NULL;
+  pd->res.width = params->width;
+  pd->res.height = params->height;
+  pd->format = params->format;
+  pd->bitdepth = params->bitdepth;
+  pd->lf = get_loss_funcs(params->asm_type);
+  pd->cascade = (params->cascade != 0);
+  pd->crop_interval = max(0, params->crop_interval);
+  pd->chroma = (params->chroma != 0 && params->format != FORMAT_YUV400);
+  pd->sub_x = (params->format == FORMAT_YUV420 || params->format == FORMAT_YUV422);
+  pd->sub_y = (params->format == FORMAT_YUV420);
+  pd->area.width = params->width;
+  pd->area.height = params->height;
+  pthread_mutex_init(&pd->area_lock, NULL);
+  cadence_init(&pd->cadence, pd->lf);
+  early_exit_init(&pd->test, confidence);
+  scan_hist_init(&pd->hist);
+  if (params->band_threads > 0 && (pd->pool = thread_pool_create(params->band_threads)) == NULL)
+    goto fail;
+  if ((pd->frame = pd_frame_create()) == NULL)
+    goto fail;
+  if (pd->crop_interval > 0 && (pd->zeros = (unsigned char *) calloc(params->width, 2)) == NULL)
+    goto fail;
+  return pd;
+
+fail:
+  pd_destroy(pd);
+  return NULL;
+}
+
+/*! Release detector context */
+void pd_destroy (pd_context_t *pd)
+{
+  if (pd == NULL) return;
+  thread_pool_destroy(pd->pool);
+  cadence_free(&pd->cadence);
+  pd_frame_destroy(pd->frame);
+  pthread_mutex_destroy(&pd->area_lock);
+  free(pd->zeros);
+  free(pd);
+}
+
+/*! Name of kernel instruction set selected for context */
+const char *pd_kernels_name (pd_context_t *pd)
+{
+  return pd->lf->name;
+}
+
+/*! Create per-frame analysis state, NULL if out of memory */
+pd_frame_t *pd_frame_create (void)
+{
+  return (pd_frame_t *) calloc(1, sizeof(pd_frame_t));
+}
+
+/*! Release per-frame analysis state */
+void pd_frame_destroy (pd_frame_t *frame)
+{
+  if (frame == NULL) return;
+  block_map_free(&frame->blocks);
+  block_map_free(&frame->chroma_blocks[0]);
+  block_map_free(&frame->chroma_blocks[1]);
+  field_sig_free(&frame->fields);
+  free(frame);
+}
+
+/*!
+ *  \brief Set the area a frame is analyzed on, detecting the active area on every crop_interval-th frame
+ *
+ *  Must be called in frame order, before the frame is analyzed, if crop_interval is set:
+ *  the area of a frame then only depends on its index, however many frames are analyzed
+ *  concurrently. Black frames & dark scenes keep the previous area.
+ *
+ *  \param[in]  pd      - context
+ *  \param[out] frame   - frame state, to be passed to pd_analyze_frame()/pd_analyze_planes()
+ *  \param[in]  luma    - luma plane
+ *  \param[in]  stride  - distance between rows [in bytes]
+ *  \param[in]  index   - frame index since the start of the stream (or of a run of frames, see pd_restart())
+ *
+ *  \returns    0 if success, !0 if stride is too small or out of memory
+ */
+int pd_detect_area (pd_context_t *pd, pd_frame_t *frame, const unsigned char *luma, int stride, int index)
+{
+  plane_t plane = {(unsigned char *)luma, stride, pd->res.width, pd->res.height, pd->bitdepth};
+  crop_t found;
+  int result = 1;
+
+  if (stride < pd->res.width * ((pd->bitdepth > 8)? 2: 1))
+    return 1;
+  if (pd->crop_interval > 0 && index % pd->crop_interval == 0)
+    result = active_area_detect(&found, &plane, pd->lf, pd->zeros);
+  pthread_mutex_lock(&pd->area_lock);
+  if (result == 0)
+    pd->area = found;
+  frame->area = pd->area;
+  pthread_mutex_unlock(&pd->area_lock);
+  return (result < 0);
+}
+
+/*! Store plane deltas & gamma of luma & chroma planes into frame state */
+static void store_deltas (pd_frame_t *frame, float deltas[][3], int num_planes)
+{
+  int k;
+
+  frame->delta_frame = deltas[0][0];
+  frame->delta_even = deltas[0][1];
+  frame->delta_odd = deltas[0][2];
+  frame->gamma = frame->delta_frame / (frame->delta_even + frame->delta_odd + 0.00001);
+  for (k=1; k<3; k++)
+    frame->chroma_gamma[k-1] = (k < num_planes)? deltas[k][0] / (deltas[k][1] + deltas[k][2] + 0.00001): 0;
+}
+
+/*!
+ *  \brief Compute statistics of a frame (thread-safe)
+ *
+ *  Several frames can be analyzed concurrently, each into its own frame state. In
+ *  cascade mode, statistics are first computed on decimated rows & columns, and again
+ *  at full resolution only if they leave the frame ambiguous (field signatures are
+ *  always computed at full resolution, for cadence detection). If crop_interval is set,
+ *  statistics are computed on the area set by pd_detect_area() (the whole frame if it
+ *  was never called on this frame state). If the context
+ *  analyzes chroma & chroma planes are given, their deltas are computed in the same
+ *  pass, on the active area scaled to the chroma sampling grid.
+ *
+ *  \param[in]  pd      - context
+ *  \param[out] frame   - frame state, to be passed to pd_commit_frame()
+ *  \param[in]  planes  - Y, U & V planes (U & V can be NULL)
+ *  \param[in]  strides - distance between rows of each plane [in bytes]
+ *
+ *  \returns    0 if success, !0 if a stride is too small or out of memory
+ */
+int pd_analyze_planes (pd_context_t *pd, pd_frame_t *frame, const unsigned char *const planes[3], const int strides[3])
+{
+  int bytes = (pd->bitdepth > 8)? 2: 1;
+  int cw = pd->res.width >> pd->sub_x, ch = pd->res.height >> pd->sub_y;
+  plane_t plane[3] = {{(unsigned char *)planes[0], strides[0], pd->res.width, pd->res.height, pd->bitdepth},
+                      {(unsigned char *)planes[1], strides[1], cw, ch, pd->bitdepth},
+                      {(unsigned char *)planes[2], strides[2], cw, ch, pd->bitdepth}};
+  block_map_t *maps[3] = {&frame->blocks, &frame->chroma_blocks[0], &frame->chroma_blocks[1]};
+  float deltas[3][3];
+  int coarse, num_planes = 1;
+
+  if (strides[0] < pd->res.width * bytes)
+    return 1;
+  if (pd->crop_interval == 0 || frame->area.width <= 0) {
+    frame->area.x = frame->area.y = 0;
+    frame->area.width = pd->res.width;
+    frame->area.height = pd->res.height;
+  }
+
+  /* chroma planes are skipped if their active area has less than two rows per field */
+  if (pd->chroma && planes[1] != NULL && planes[2] != NULL && (frame->area.height >> pd->sub_y) >= 4 && (frame->area.width >> pd->sub_x) > 0) {
+    if (strides[1] < cw * bytes || strides[2] < cw * bytes)
+      return 1;
+    num_planes = 3;
+  }
+
+  /* rows narrower than a kernel block are always analyzed at full resolution */
+  coarse = pd->cascade && frame->area.width >= 16;
+  if (calculate_deltas(plane, num_planes, pd->sub_x, pd->sub_y, &frame->area, pd->lf, coarse, pd->pool, maps, &frame->fields, deltas))
+    return 1;
+  store_deltas(frame, deltas, num_planes);
+  frame->chroma = (num_planes > 1);
+  frame->escalated = 0;
+
+  /* cascade: ambiguous frames are analyzed again at full resolution */
+  if (coarse && cascade_ambiguous(frame)) {
+    if (calculate_deltas(plane, num_planes, pd->sub_x, pd->sub_y, &frame->area, pd->lf, 0, pd->pool, maps, NULL, deltas))
+      return 1;
+    store_deltas(frame, deltas, num_planes);
+    frame->escalated = 1;
+  }
+  frame->combed_blocks = block_map_combed(&frame->blocks, COMB_GAMMA_THRESHOLD, frame->blocks.cols * frame->blocks.rows);
+  return 0;
+}
+
+/*!
+ *  \brief Compute statistics of the luma plane of a frame (thread-safe), see pd_analyze_planes()
+ *
+ *  \param[in]  pd      - context
+ *  \param[out] frame   - frame state, to be passed to pd_commit_frame()
+ *  \param[in]  luma    - luma plane
+ *  \param[in]  stride  - distance between rows [in bytes]
+ *
+ *  \returns    0 if success, !0 if stride is too small or out of memory
+ */
+int pd_analyze_frame (pd_context_t *pd, pd_frame_t *frame, const unsigned char *luma, int stride)
+{
+  const unsigned char *planes[3] = {luma, NULL, NULL};
+  int strides[3] = {stride, 0, 0};
+
+  return pd_analyze_planes(pd, frame, planes, strides);
+}
+
+/*!
+ *  \brief Update detector with an analyzed frame
+ *
+ *  Must be called in frame order. Field signatures of frame are taken over by the
+ *  cadence detector, so frame state must be analyzed again before it is committed again.
+ *
+ *  \param[in]  pd      - context
+ *  \param[in]  frame   - frame state filled by pd_analyze_frame()
+ *  \param[out] result  - frame statistics & field matching decision (can be NULL)
+ *
+ *  \returns    1 once scan type is decided, 0 otherwise
+ */
+int pd_commit_frame (pd_context_t *pd, pd_frame_t *frame, pd_frame_result_t *result)
+{
+  cadence_result_t cr;
+
+  cadence_push(&pd->cadence, &frame->fields, &cr);
+  early_exit_push(&pd->test, frame);
+  scan_hist_push(&pd->hist, frame, &cr);
+  pd->frames ++;
+  if (frame->combed_blocks > 0)
+    pd->combed_frames ++;
+  pd->escalated_frames += frame->escalated;
+  if (frame->chroma) {
+    running_stats_push(&pd->chroma_gamma[0], frame->chroma_gamma[0]);
+    running_stats_push(&pd->chroma_gamma[1], frame->chroma_gamma[1]);
+    if (frame->gamma <= COMB_GAMMA_THRESHOLD && max(frame->chroma_gamma[0], frame->chroma_gamma[1]) > COMB_GAMMA_THRESHOLD)
+      pd->chroma_combed_frames ++;
+  }
+
+  if (result != NULL) {
+    result->delta_frame = frame->delta_frame;
+    result->delta_even = frame->delta_even;
+    result->delta_odd = frame->delta_odd;
+    result->gamma = frame->gamma;
+    result->combed_blocks = frame->combed_blocks;
+    result->match = cr.match;
+    result->drop = cr.drop;
+    result->phase = cr.phase;
+    result->order = cr.order;
+    result->escalated = frame->escalated;
+    result->gamma_u = frame->chroma_gamma[0];
+    result->gamma_v = frame->chroma_gamma[1];
+  }
+  return pd->test.verdict != 0;
+}
+
+/*!
+ *  \brief Analyze next frame & update detector
+ *
+ *  \param[in]  pd      - context
+ *  \param[in]  luma    - luma plane
+ *  \param[in]  stride  - distance between rows [in bytes]
+ *  \param[out] result  - frame statistics & field matching decision (can be NULL)
+ *
+ *  \returns    1 once scan type is decided, 0 otherwise, -1 if stride is too small or out of memory
+ */
+int pd_push_frame (pd_context_t *pd, const unsigned char *luma, int stride, pd_frame_result_t *result)
+{
+  if (pd_detect_area(pd, pd->frame, luma, stride, pd->pushed++) || pd_analyze_frame(pd, pd->frame, luma, stride))
+    return -1;
+  return pd_commit_frame(pd, pd->frame, result);
+}
+
+/*!
+ *  \brief Analyze next frame, given by its Y, U & V planes, & update detector
+ *
+ *  \param[in]  pd      - context
+ *  \param[in]  planes  - Y, U & V planes (U & V can be NULL)
+ *  \param[in]  strides - distance between rows of each plane [in bytes]
+ *  \param[out] result  - frame statistics & field matching decision (can be NULL)
+ *
+ *  \returns    1 once scan type is decided, 0 otherwise, -1 if a stride is too small or out of memory
+ */
+int pd_push_planes (pd_context_t *pd, const unsigned char *const planes[3], const int strides[3], pd_frame_result_t *result)
+{
+  if (pd_detect_area(pd, pd->frame, planes[0], strides[0], pd->pushed++) || pd_analyze_planes(pd, pd->frame, planes, strides))
+    return -1;
+  return pd_commit_frame(pd, pd->frame, result);
+}
+
+/*! Prepare context for a new stream with the same parameters, keeping its buffers */
+void pd_reset (pd_context_t *pd)
+{
+  field_sig_t prev = pd->cadence.prev;
+
+  cadence_init(&pd->cadence, pd->lf);
+  pd->cadence.prev = prev;
+  early_exit_init(&pd->test, pd->test.confidence);
+  scan_hist_init(&pd->hist);
+  pd->frames = 0;
+  pd->combed_frames = 0;
+  pd->escalated_frames = 0;
+  memset(pd->chroma_gamma, 0, sizeof(pd->chroma_gamma));
+  pd->chroma_combed_frames = 0;
+  pd->pushed = 0;
+  pd->area.x = pd->area.y = 0;
+  pd->area.width = pd->res.width;
+  pd->area.height = pd->res.height;
+}
+
+/*! Start a new run of consecutive frames: next frame is not matched against the previous one, & active area is detected again on the next frame pushed (pd_detect_area() callers restart their frame index) */
+void pd_restart (pd_context_t *pd)
+{
+  cadence_restart(&pd->cadence);
+  pd->pushed = 0;
+}
+
+/*!
+ *  \brief Get detection result over frames committed so far
+ *
+ *  \returns    0 if success
+ */
+int pd_get_result (pd_context_t *pd, pd_result_t *result)
+{
+  early_exit_t *ee = &pd->test;
+
+  memset(result, 0, sizeof(pd_result_t));
+  result->frames = pd->frames;
+  result->decided = (ee->verdict != 0);
+  result->scan_type = scan_hist_classify(&pd->hist);
+  result->telecine = (pd->cadence.phase >= 0);
+  result->combed_frames = pd->combed_frames;
+  result->escalated_frames = pd->escalated_frames;
+  result->chroma_frames = pd->chroma_gamma[0].n;
+  result->chroma_combed_frames = pd->chroma_combed_frames;
+  result->gamma_u_mean = pd->chroma_gamma[0].mean;
+  result->gamma_v_mean = pd->chroma_gamma[1].mean;
+  result->locked_frames = pd->cadence.locked_frames;
+  result->breaks = pd->cadence.breaks;
+  result->drops = pd->cadence.drops;
+  result->tff_votes = pd->cadence.tff_votes;
+  result->bff_votes = pd->cadence.bff_votes;
+  result->observed = ee->observed;
+  result->combed = ee->combed;
+  result->llr = ee->llr;
+  result->gamma_mean = ee->gamma.mean;
+  result->gamma_stddev = running_stats_stddev(&ee->gamma);
+  result->delta_even_mean = ee->delta_even.mean;
+  result->delta_even_stddev = running_stats_stddev(&ee->delta_even);
+  result->delta_odd_mean = ee->delta_odd.mean;
+  result->delta_odd_stddev = running_stats_stddev(&ee->delta_odd);
+  result->gamma_median = histogram_quantile(&pd->hist.gamma, 0.5);
+  result->field_diff_median = histogram_quantile(&pd->hist.field_diff, 0.5);
+  pthread_mutex_lock(&pd->area_lock);
+  result->area_x = pd->area.x;
+  result->area_y = pd->area.y;
+  result->area_width = pd->area.width;
+  result->area_height = pd->area.height;
+  pthread_mutex_unlock(&pd->area_lock);
+  return 0;
+}
+
+/*!
+ *  \brief Add statistics of another stream, e.g. another chunk of the same stream
+ *
+ *  Histograms, counters, means & deviations of src are added to dst, so that the result
+ *  of dst classifies both streams. The sequential test & cadence state of dst are kept.
+ *
+ *  \returns    0 if success, 1 if contexts have different parameters
+ */
+int pd_merge (pd_context_t *dst, const pd_context_t *src)
+{
+  if (dst->res.width != src->res.width || dst->res.height != src->res.height || dst->bitdepth != src->bitdepth)
+    return 1;
+  if (scan_hist_merge(&dst->hist, &src->hist))
+    return 1;
+  running_stats_merge(&dst->test.gamma, &src->test.gamma);
+  running_stats_merge(&dst->test.delta_even, &src->test.delta_even);
+  running_stats_merge(&dst->test.delta_odd, &src->test.delta_odd);
+  dst->test.observed += src->test.observed;
+  dst->test.combed += src->test.combed;
+  dst->cadence.locked_frames += src->cadence.locked_frames;
+  dst->cadence.breaks += src->cadence.breaks;
+  dst->cadence.drops += src->cadence.drops;
+  dst->cadence.tff_votes += src->cadence.tff_votes;
+  dst->cadence.bff_votes += src->cadence.bff_votes;
+  dst->frames += src->frames;
+  dst->combed_frames += src->combed_frames;
+  dst->escalated_frames += src->escalated_frames;
+  running_stats_merge(&dst->chroma_gamma[0], &src->chroma_gamma[0]);
+  running_stats_merge(&dst->chroma_gamma[1], &src->chroma_gamma[1]);
+  dst->chroma_combed_frames += src->chroma_combed_frames;
+  return 0;
+}
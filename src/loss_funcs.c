@@ -0,0 +1,112 @@
+/*!
+ *  \file     loss_funcs.c
+ *  \brief    Run-time selection of SAD/SSD loss kernels
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _MSC_VER
+#include <strings.h>
+#else
+#define strcasecmp _stricmp
+#endif
+
+#include "pattern_detector.h"
+
+/* AVX-512 kernels, replaced by AVX2 ones if the compiler lacks AVX-512 (never selected then) */
+#ifdef NON_AVX512_SUPPORT
+#define sad_nx8_u8_avx512_intrin        sad_nx8_u8_avx2_intrin
+#define ssd_nx8_u8_avx512_intrin        ssd_nx8_u8_avx2_intrin
+#define sad_nx16_u8_avx512_intrin       sad_nx16_u8_avx2_intrin
+#define ssd_nx16_u8_avx512_intrin       ssd_nx16_u8_avx2_intrin
+#define ssd2_nx16_u8_avx512_intrin      ssd2_nx16_u8_avx2_intrin
+#define sad_nx8_u16_avx512_intrin       sad_nx8_u16_avx2_intrin
+#define ssd_nx8_u16_avx512_intrin       ssd_nx8_u16_avx2_intrin
+#define sad_nx16_u16_avx512_intrin      sad_nx16_u16_avx2_intrin
+#define ssd_nx16_u16_avx512_intrin      ssd_nx16_u16_avx2_intrin
+#define ssd2_nx16_u16_avx512_intrin     ssd2_nx16_u16_avx2_intrin
+#define avg_2x2_u8_avx512_intrin        avg_2x2_u8_avx2_intrin
+#define ssd2_row_u8_avx512_intrin       ssd2_row_u8_avx2_intrin
+#define ssd2_row_u16_avx512_intrin      ssd2_row_u16_avx2_intrin
+#define ssd2_rows_u8_avx512_intrin      ssd2_rows_u8_avx2_intrin
+#define ssd2_rows_any_u8_avx512_intrin  ssd2_rows_any_u8_avx2_intrin
+#define ssd_nx8_u8_avx512vnni_intrin    ssd_nx8_u8_avx2_intrin
+#define ssd_nx16_u8_avx512vnni_intrin   ssd_nx16_u8_avx2_intrin
+#define ssd2_nx16_u8_avx512vnni_intrin  ssd2_nx16_u8_avx2_intrin
+#define ssd2_row_u8_avx512vnni_intrin   ssd2_row_u8_avx2_intrin
+#define ssd2_rows_u8_avx512vnni_intrin  ssd2_rows_u8_avx2_intrin
+#define ssd2_rows_any_u8_avx512vnni_intrin ssd2_rows_any_u8_avx2_intrin
+#endif
+
+/* Kernel tables, indexed by ASM type (ASM_C, ASM_SSE2, ASM_AVX2, ASM_AVX512, ASM_AVX512_VNNI) */
+static const loss_funcs_t loss_funcs_table[ASM_TYPE_TOTAL] =
+{
+  {ASM_C,    "c",    sad_nx8_u8_c,            ssd_nx8_u8_c,            sad_nx16_u8_c,            ssd_nx16_u8_c,            ssd2_nx16_u8_c,
+                     sad_nx8_u16_c,           ssd_nx8_u16_c,           sad_nx16_u16_c,           ssd_nx16_u16_c,           ssd2_nx16_u16_c,
+                     avg_2x2_u8_c,             ssd2_row_u8_c,           ssd2_row_u16_c,           ssd2_rows_u8_c,           ssd2_rows_u8_c},
+  {ASM_SSE2, "sse2", sad_nx8_u8_sse2_intrin,  ssd_nx8_u8_sse2_intrin,  sad_nx16_u8_sse2_intrin,  ssd_nx16_u8_sse2_intrin,  ssd2_nx16_u8_sse2_intrin,
+                     sad_nx8_u16_sse2_intrin, ssd_nx8_u16_sse2_intrin, sad_nx16_u16_sse2_intrin, ssd_nx16_u16_sse2_intrin, ssd2_nx16_u16_sse2_intrin,
+                     avg_2x2_u8_sse2_intrin,   ssd2_row_u8_sse2_intrin, ssd2_row_u16_sse2_intrin, ssd2_rows_u8_sse2_intrin, ssd2_rows_u8_sse2_intrin},
+  {ASM_AVX2, "avx2", sad_nx8_u8_avx2_intrin,  ssd_nx8_u8_avx2_intrin,  sad_nx16_u8_avx2_intrin,  ssd_nx16_u8_avx2_intrin,  ssd2_nx16_u8_avx2_intrin,
+                     sad_nx8_u16_avx2_intrin, ssd_nx8_u16_avx2_intrin, sad_nx16_u16_avx2_intrin, ssd_nx16_u16_avx2_intrin, ssd2_nx16_u16_avx2_intrin,
+                     avg_2x2_u8_avx2_intrin,   ssd2_row_u8_avx2_intrin, ssd2_row_u16_avx2_intrin, ssd2_rows_u8_avx2_intrin, ssd2_rows_any_u8_avx2_intrin},
+  {ASM_AVX512, "avx512", sad_nx8_u8_avx512_intrin, ssd_nx8_u8_avx512_intrin, sad_nx16_u8_avx512_intrin, ssd_nx16_u8_avx512_intrin, ssd2_nx16_u8_avx512_intrin,
+                     sad_nx8_u16_avx512_intrin, ssd_nx8_u16_avx512_intrin, sad_nx16_u16_avx512_intrin, ssd_nx16_u16_avx512_intrin, ssd2_nx16_u16_avx512_intrin,
+                     avg_2x2_u8_avx512_intrin, ssd2_row_u8_avx512_intrin, ssd2_row_u16_avx512_intrin, ssd2_rows_u8_avx512_intrin, ssd2_rows_any_u8_avx512_intrin},
+  {ASM_AVX512_VNNI, "avx512vnni", sad_nx8_u8_avx512_intrin, ssd_nx8_u8_avx512vnni_intrin, sad_nx16_u8_avx512_intrin, ssd_nx16_u8_avx512vnni_intrin, ssd2_nx16_u8_avx512vnni_intrin,
+                     sad_nx8_u16_avx512_intrin, ssd_nx8_u16_avx512_intrin, sad_nx16_u16_avx512_intrin, ssd_nx16_u16_avx512_intrin, ssd2_nx16_u16_avx512_intrin,
+                     avg_2x2_u8_avx512_intrin, ssd2_row_u8_avx512vnni_intrin, ssd2_row_u16_avx512_intrin, ssd2_rows_u8_avx512vnni_intrin, ssd2_rows_any_u8_avx512vnni_intrin}
+};
+
+/*!
+ *  \brief Map ASM bit-field returned by get_cpu_asm_type() to the fastest kernel table index
+ */
+int cpu_asm_type (void)
+{
+  unsigned int asm_mask = get_cpu_asm_type();
+#ifndef NON_AVX512_SUPPORT
+  if (asm_mask & AVX512_VNNI_MASK)  return ASM_AVX512_VNNI;
+  if (asm_mask & AVX512_MASK)   return ASM_AVX512;
+#endif
+  if (asm_mask & AVX2_MASK)     return ASM_AVX2;
+  if (asm_mask & PREAVX2_MASK)  return ASM_SSE2;
+  return ASM_C;
+}
+
+/*!
+ *  \brief Find ASM type by name ("c", "sse2", "avx2", "avx512", "avx512vnni" or "auto")
+ *
+ *  \param[in]  name      - ASM type name
+ *  \param[out] asm_type  - ASM type, or ASM_AUTO for "auto"
+ *
+ *  \returns  0 if success, 1 if name is not recognized
+ */
+int asm_type_by_name (const char *name, int *asm_type)
+{
+  int i;
+  if (!strcasecmp(name, "auto")) {*asm_type = ASM_AUTO; return 0;}
+  for (i=0; i<ASM_TYPE_TOTAL; i++)
+    if (!strcasecmp(name, loss_funcs_table[i].name)) {*asm_type = i; return 0;}
+  return 1;
+}
+
+/*!
+ *  \brief Select kernel table
+ *
+ *  \param[in]  asm_type  - requested ASM type, or ASM_AUTO to pick the fastest supported one
+ *
+ *  \returns  kernel table for the requested ASM type, limited to what the CPU supports
+ */
+const loss_funcs_t *get_loss_funcs (int asm_type)
+{
+  int cpu_type = cpu_asm_type();
+  if (asm_type == ASM_AUTO || asm_type > cpu_type) asm_type = cpu_type;
+  return &loss_funcs_table[asm_type];
+}
@@ -130,4 +130,541 @@ int ssd_nx16_u8_avx2_intrin (unsigned char *p, unsigned char *q, int pitch, int
     _mm256_storeu_si256((__m256i*) &result[0], ssd);
 
    return result[0];
-}
\ No newline at end of file
+}
+/*!
+ * @brief Calcalute sums of squared difference of one nx16 window against two others with AVX2
+ * 
+ * Each block of p is loaded once and compared against q and r, so that the
+ * frame (i vs i+1) and field (i vs i+2) row differences are computed in one pass.
+ * 
+ * @param p        reference array of data
+ * @param q        2nd array of data
+ * @param r        3rd array of data
+ * @param pitch    16 bytes length
+ * @param n        n = len(array)/pitch
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_nx16_u8_avx2_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int pitch, int n, int *ssd_pq, int *ssd_pr)
+{
+   __m256i vp, va, vb;
+   __m128i s;
+   int i;
+
+   __m256i pq = _mm256_setzero_si256();
+   __m256i pr = _mm256_setzero_si256();
+   for (i=0; i<n; i++) {
+      vp = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *)(p+i*pitch)));
+      va = _mm256_sub_epi16(vp, _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *)(q+i*pitch))));
+      vb = _mm256_sub_epi16(vp, _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *)(r+i*pitch))));
+      pq = _mm256_add_epi32(pq, _mm256_madd_epi16(va, va));
+      pr = _mm256_add_epi32(pr, _mm256_madd_epi16(vb, vb));
+   }
+
+   /* fold 256 -> 128 bits, then horizontal add of 4 lanes */
+   s = _mm_add_epi32(_mm256_castsi256_si128(pq), _mm256_extracti128_si256(pq, 1));
+   s = _mm_hadd_epi32(s, s);
+   *ssd_pq = _mm_cvtsi128_si32(_mm_hadd_epi32(s, s));
+   s = _mm_add_epi32(_mm256_castsi256_si128(pr), _mm256_extracti128_si256(pr, 1));
+   s = _mm_hadd_epi32(s, s);
+   *ssd_pr = _mm_cvtsi128_si32(_mm_hadd_epi32(s, s));
+}
+
+/* lane masks of row tails: 16 bytes (or samples) loaded at offset t keep the last t lanes */
+static const unsigned char tail_mask_u8[32] = {
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+static const uint16_t tail_mask_u16[32] = {
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF
+};
+
+/*! SSD of two vectors of 16 bytes */
+static inline int ssd_epu8 (__m128i a, __m128i b)
+{
+   __m256i va = _mm256_sub_epi16(_mm256_cvtepu8_epi16(a), _mm256_cvtepu8_epi16(b));
+   __m256i ssd = _mm256_madd_epi16(va, va);
+   __m128i s = _mm_add_epi32(_mm256_castsi256_si128(ssd), _mm256_extracti128_si256(ssd, 1));
+   s = _mm_hadd_epi32(s, s);
+   return _mm_cvtsi128_si32(_mm_hadd_epi32(s, s));
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one row against two others with AVX2
+ * 
+ * Whole 16-byte blocks go through the nx16 kernel. The last n % 16 bytes are compared
+ * in the 16-byte block ending the row, with its lanes already counted masked out, so
+ * that nothing is read past the row.
+ * 
+ * @param p        reference row
+ * @param q        2nd row
+ * @param r        3rd row
+ * @param n        row length [in samples], any value
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_row_u8_avx2_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr)
+{
+   __m128i m, vp;
+   int t = n % 16;
+
+   if (n < 16) {
+      ssd2_row_u8_c(p, q, r, n, ssd_pq, ssd_pr);
+      return;
+   }
+   ssd2_nx16_u8_avx2_intrin(p, q, r, 16, n/16, ssd_pq, ssd_pr);
+   if (t) {
+      p += n - 16, q += n - 16, r += n - 16;
+      m = _mm_loadu_si128((__m128i *)(tail_mask_u8 + t));
+      vp = _mm_and_si128(m, _mm_loadu_si128((__m128i *)p));
+      *ssd_pq += ssd_epu8(vp, _mm_and_si128(m, _mm_loadu_si128((__m128i *)q)));
+      *ssd_pr += ssd_epu8(vp, _mm_and_si128(m, _mm_loadu_si128((__m128i *)r)));
+   }
+}
+
+/*
+ * Block row kernel: up to BLOCK_HEIGHT rows are compared against their next row & field
+ * partner one 32-byte strip of a statistics block at a time, walking down the rows so
+ * that each row is loaded & widened once and reused as p, q & r. Sums stay in 32-bit
+ * lanes of independent accumulators (frame, even & odd field rows, low & high bytes)
+ * until the block is done, then are reduced together, once per block. Full blocks
+ * (BLOCK_WIDTH x BLOCK_HEIGHT, all rows with a field partner) take a copy of the kernel
+ * with strips & rows known at compile time, rows unrolled (unrolling strips too makes
+ * it slower: the code outgrows the instruction caches); the last, partial block of a
+ * row and the last rows of a plane take the same code with run-time sizes.
+ */
+
+/*! Accumulators of one statistics block */
+typedef struct {
+   __m256i frame_lo, frame_hi;
+   __m256i field_lo[2], field_hi[2];    //!< rows of even & odd index
+} rows_acc_t;
+
+/*!
+ * Load bytes of row as 16-bit lanes: 32 bytes (n == 32), 16 bytes (n == 16), or the last
+ * n < 16 bytes of the 16 bytes at row (others zeroed)
+ */
+static inline __attribute__((always_inline)) void load_row_u8 (const unsigned char *row, int n, __m256i *lo, __m256i *hi)
+{
+   __m256i v;
+
+   if (n == 32) {
+      v = _mm256_loadu_si256((__m256i *)row);
+      *lo = _mm256_unpacklo_epi8(v, _mm256_setzero_si256());
+      *hi = _mm256_unpackhi_epi8(v, _mm256_setzero_si256());
+   } else {
+      *lo = _mm256_cvtepu8_epi16((n == 16)? _mm_loadu_si128((__m128i *)row):
+                                 _mm_and_si128(_mm_loadu_si128((__m128i *)(tail_mask_u8 + n)), _mm_loadu_si128((__m128i *)row)));
+      *hi = _mm256_setzero_si256();
+   }
+}
+
+/*! Add squared differences of 16-bit lanes of a & b to 32-bit lanes of acc */
+static inline __m256i add_sq_diff_epi16 (__m256i acc, __m256i a, __m256i b)
+{
+   __m256i d = _mm256_sub_epi16(a, b);
+   return _mm256_add_epi32(acc, _mm256_madd_epi16(d, d));
+}
+
+/*! Compare row a against next row b & field partner c, field sums to accumulators of rows of parity f */
+static inline __attribute__((always_inline)) void ssd2_step_u8 (rows_acc_t *acc, int f, __m256i a_lo, __m256i a_hi, __m256i b_lo, __m256i b_hi, __m256i c_lo, __m256i c_hi)
+{
+   acc->frame_lo = add_sq_diff_epi16(acc->frame_lo, a_lo, b_lo);
+   acc->frame_hi = add_sq_diff_epi16(acc->frame_hi, a_hi, b_hi);
+   acc->field_lo[f] = add_sq_diff_epi16(acc->field_lo[f], a_lo, c_lo);
+   acc->field_hi[f] = add_sq_diff_epi16(acc->field_hi[f], a_hi, c_hi);
+}
+
+/*! Accumulate one strip of n bytes (see load_row_u8()) down frame_rows rows, of which field_rows have a field partner */
+static inline __attribute__((always_inline)) void ssd2_strip_u8 (unsigned char *p, int stride, int n, int frame_rows, int field_rows, rows_acc_t *acc)
+{
+   __m256i a_lo, a_hi, b_lo, b_hi, c_lo, c_hi, d_lo, d_hi;
+   int k;
+
+   load_row_u8(p, n, &a_lo, &a_hi);
+   load_row_u8(p + stride, n, &b_lo, &b_hi);
+   /* rows by pairs, so that even & odd rows add to their own field accumulators */
+   for (k=0; k+2<=field_rows; k+=2) {
+      load_row_u8(p + (size_t)(k+2)*stride, n, &c_lo, &c_hi);
+      load_row_u8(p + (size_t)(k+3)*stride, n, &d_lo, &d_hi);
+      ssd2_step_u8(acc, 0, a_lo, a_hi, b_lo, b_hi, c_lo, c_hi);
+      ssd2_step_u8(acc, 1, b_lo, b_hi, c_lo, c_hi, d_lo, d_hi);
+      a_lo = c_lo, a_hi = c_hi;
+      b_lo = d_lo, b_hi = d_hi;
+   }
+   if (k < field_rows) {
+      load_row_u8(p + (size_t)(k+2)*stride, n, &c_lo, &c_hi);
+      ssd2_step_u8(acc, 0, a_lo, a_hi, b_lo, b_hi, c_lo, c_hi);
+      a_lo = b_lo, a_hi = b_hi;
+      b_lo = c_lo, b_hi = c_hi;
+      k++;
+   }
+   for (; k<frame_rows; k++) {
+      acc->frame_lo = add_sq_diff_epi16(acc->frame_lo, a_lo, b_lo);
+      acc->frame_hi = add_sq_diff_epi16(acc->frame_hi, a_hi, b_hi);
+      if (k+1 < frame_rows) {
+         a_lo = b_lo, a_hi = b_hi;
+         load_row_u8(p + (size_t)(k+2)*stride, n, &b_lo, &b_hi);
+      }
+   }
+}
+
+/*! Accumulate one block of n bytes of frame_rows rows, of which field_rows have a field partner */
+static inline __attribute__((always_inline)) void ssd2_block_u8 (unsigned char *p, int stride, int n, int frame_rows, int field_rows, rows_acc_t *acc)
+{
+   int x;
+
+   for (x=0; x+32<=n; x+=32)
+      ssd2_strip_u8(p+x, stride, 32, frame_rows, field_rows, acc);
+   if (x+16 <= n) {
+      ssd2_strip_u8(p+x, stride, 16, frame_rows, field_rows, acc);
+      x += 16;
+   }
+   if (x < n)    // last n - x bytes, in the 16 bytes ending the block (a block or 16 bytes precede them)
+      ssd2_strip_u8(p+n-16, stride, n-x, frame_rows, field_rows, acc);
+}
+
+/*!
+ * Accumulate a full block, BLOCK_WIDTH bytes (a multiple of 32) of BLOCK_HEIGHT rows (even)
+ * that all have a field partner: strips & rows known at compile time, rows unrolled
+ */
+static inline __attribute__((always_inline)) void ssd2_full_block_u8 (unsigned char *p, int stride, rows_acc_t *acc)
+{
+   __m256i a_lo, a_hi, b_lo, b_hi, c_lo, c_hi, d_lo, d_hi;
+   int x, k;
+
+   for (x=0; x<BLOCK_WIDTH; x+=32) {
+      load_row_u8(p+x, 32, &a_lo, &a_hi);
+      load_row_u8(p+x + stride, 32, &b_lo, &b_hi);
+#pragma GCC unroll 16
+      for (k=0; k<BLOCK_HEIGHT; k+=2) {
+         load_row_u8(p+x + (size_t)(k+2)*stride, 32, &c_lo, &c_hi);
+         load_row_u8(p+x + (size_t)(k+3)*stride, 32, &d_lo, &d_hi);
+         ssd2_step_u8(acc, 0, a_lo, a_hi, b_lo, b_hi, c_lo, c_hi);
+         ssd2_step_u8(acc, 1, b_lo, b_hi, c_lo, c_hi, d_lo, d_hi);
+         a_lo = c_lo, a_hi = c_hi;
+         b_lo = d_lo, b_hi = d_hi;
+      }
+   }
+}
+
+/*! Add the three sums of a block to *dd_frame, *dd_field0 & *dd_field1, with one reduction: frame, even & odd field rows in lanes 0, 1 & 2 */
+static inline void reduce_acc (rows_acc_t *acc, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1)
+{
+   __m256i h;
+   __m128i s;
+
+   h = _mm256_hadd_epi32(_mm256_add_epi32(acc->frame_lo, acc->frame_hi), _mm256_add_epi32(acc->field_lo[0], acc->field_hi[0]));
+   h = _mm256_hadd_epi32(h, _mm256_hadd_epi32(_mm256_add_epi32(acc->field_lo[1], acc->field_hi[1]), _mm256_setzero_si256()));
+   s = _mm_add_epi32(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+   *dd_frame += (uint32_t)_mm_cvtsi128_si32(s);
+   *dd_field0 += (uint32_t)_mm_extract_epi32(s, 1);
+   *dd_field1 += (uint32_t)_mm_extract_epi32(s, 2);
+}
+
+/*! Block row kernel, with the full-block copy if full_blocks */
+static inline __attribute__((always_inline)) void ssd2_rows_u8 (unsigned char *p, int stride, int width, int frame_rows, int field_rows,
+                                                                uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1, int full_blocks)
+{
+   rows_acc_t acc;
+   int c = 0, j = 0;
+
+   if (width < 16) {
+      ssd2_rows_u8_c(p, stride, width, frame_rows, field_rows, dd_frame, dd_field0, dd_field1);
+      return;
+   }
+   if (full_blocks && BLOCK_WIDTH % 32 == 0 && BLOCK_HEIGHT % 2 == 0 && field_rows == BLOCK_HEIGHT) {
+      for (; j+BLOCK_WIDTH<=width; c++, j+=BLOCK_WIDTH) {
+         acc.frame_lo = acc.frame_hi = _mm256_setzero_si256();
+         acc.field_lo[0] = acc.field_hi[0] = acc.field_lo[1] = acc.field_hi[1] = _mm256_setzero_si256();
+         ssd2_full_block_u8(p+j, stride, &acc);
+         reduce_acc(&acc, &dd_frame[c], &dd_field0[c], &dd_field1[c]);
+      }
+   }
+   for (; j<width; c++, j+=BLOCK_WIDTH) {
+      acc.frame_lo = acc.frame_hi = _mm256_setzero_si256();
+      acc.field_lo[0] = acc.field_hi[0] = acc.field_lo[1] = acc.field_hi[1] = _mm256_setzero_si256();
+      ssd2_block_u8(p+j, stride, min(BLOCK_WIDTH, width - j), frame_rows, field_rows, &acc);
+      reduce_acc(&acc, &dd_frame[c], &dd_field0[c], &dd_field1[c]);
+   }
+}
+
+/*!
+ * @brief Accumulate SSDs of a row of statistics blocks against next rows & field partners with AVX2
+ *
+ * Row k (k < frame_rows) is compared against row k+1, and also against row k+2 if
+ * k < field_rows. Sums of each block of BLOCK_WIDTH columns are added to dd_frame[c],
+ * and field sums to dd_field0[c] (even k) or dd_field1[c] (odd k).
+ *
+ * @param p          first row
+ * @param stride     distance between rows [in bytes]
+ * @param width      row length [in samples], any value
+ * @param frame_rows number of rows compared against their next row, at most BLOCK_HEIGHT
+ * @param field_rows number of rows compared against their field partner, at most frame_rows
+ * @param dd_frame   frame SSDs, one per block
+ * @param dd_field0  field SSDs of even rows, one per block
+ * @param dd_field1  field SSDs of odd rows, one per block
+ */
+void ssd2_rows_u8_avx2_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1)
+{
+   ssd2_rows_u8(p, stride, width, frame_rows, field_rows, dd_frame, dd_field0, dd_field1, 1);
+}
+
+/*!
+ * @brief ssd2_rows_u8_avx2_intrin() with block sizes at run time only, without the full-block copy (reference for the benchmark)
+ */
+void ssd2_rows_any_u8_avx2_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1)
+{
+   ssd2_rows_u8(p, stride, width, frame_rows, field_rows, dd_frame, dd_field0, dd_field1, 0);
+}
+
+/*
+ * 16-bit sample kernels: differences are taken as |p - q| with saturating subtractions,
+ * so that full 16-bit input is handled exactly; squares are formed from the low & high
+ * halves of 16x16-bit products, and all sums are accumulated in 64-bit lanes.
+ */
+
+/* max number of blocks summed in 32-bit lanes before widening SAD (up to 2 x 0xFFFF per lane & block pair) */
+#define SAD_U16_BLOCKS  16384
+
+/*! |a - b| of unsigned 16-bit lanes */
+static inline __m256i absdiff_epu16 (__m256i a, __m256i b)
+{
+   return _mm256_or_si256(_mm256_subs_epu16(a, b), _mm256_subs_epu16(b, a));
+}
+
+/*! Add unsigned 32-bit lanes of x to 64-bit lanes of acc */
+static inline __m256i add_epu32_epi64 (__m256i acc, __m256i x)
+{
+   __m256i zeros = _mm256_setzero_si256();
+   acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(x, zeros));
+   return _mm256_add_epi64(acc, _mm256_unpackhi_epi32(x, zeros));
+}
+
+/*! Add squares of unsigned 16-bit lanes of d to 64-bit lanes of acc */
+static inline __m256i add_sq_epu16 (__m256i acc, __m256i d)
+{
+   __m256i lo = _mm256_mullo_epi16(d, d);
+   __m256i hi = _mm256_mulhi_epu16(d, d);
+   acc = add_epu32_epi64(acc, _mm256_unpacklo_epi16(lo, hi));
+   return add_epu32_epi64(acc, _mm256_unpackhi_epi16(lo, hi));
+}
+
+/*! Sum of 64-bit lanes */
+static inline uint64_t hsum_epi64 (__m256i x)
+{
+   __m128i s = _mm_add_epi64(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+   return (uint64_t)_mm_cvtsi128_si64(_mm_add_epi64(s, _mm_unpackhi_epi64(s, s)));
+}
+
+/*! Load two 8-sample blocks into one register */
+static inline __m256i load2_epi16 (uint16_t *lo, uint16_t *hi)
+{
+   return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((__m128i *)lo)), _mm_loadu_si128((__m128i *)hi), 1);
+}
+
+/*! Load one 8-sample block into the low half of a register, upper half zeroed */
+static inline __m256i load1_epi16 (uint16_t *lo)
+{
+   return _mm256_inserti128_si256(_mm256_setzero_si256(), _mm_loadu_si128((__m128i *)lo), 0);
+}
+
+/*! Add |a - b| of unsigned 16-bit lanes to 32-bit lanes of acc */
+static inline __m256i add_absdiff_epu16 (__m256i acc, __m256i a, __m256i b)
+{
+   __m256i zeros = _mm256_setzero_si256();
+   __m256i d = absdiff_epu16(a, b);
+   return _mm256_add_epi32(acc, _mm256_add_epi32(_mm256_unpacklo_epi16(d, zeros), _mm256_unpackhi_epi16(d, zeros)));
+}
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx8 window of 16-bit samples with AVX2
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    8 samples length
+ * @param n        n = len(array)/pitch
+ * @return uint64_t 
+ */
+uint64_t sad_nx8_u16_avx2_intrin (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   __m256i s;
+   int i, m;
+
+   __m256i sad = _mm256_setzero_si256();
+   for (i=0; i+1<n; ) {
+      /* two blocks per iteration */
+      s = _mm256_setzero_si256();
+      for (m=min(n-1, i+SAD_U16_BLOCKS); i<m; i+=2)
+         s = add_absdiff_epu16(s, load2_epi16(p+i*pitch, p+(i+1)*pitch), load2_epi16(q+i*pitch, q+(i+1)*pitch));
+      sad = add_epu32_epi64(sad, s);
+   }
+   if (i < n) {
+      /* odd block: upper half of difference is zero */
+      s = add_absdiff_epu16(_mm256_setzero_si256(), load1_epi16(p+i*pitch), load1_epi16(q+i*pitch));
+      sad = add_epu32_epi64(sad, s);
+   }
+   return hsum_epi64(sad);
+}
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx16 window of 16-bit samples with AVX2
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    16 samples length
+ * @param n        n = len(array)/pitch
+ * @return uint64_t 
+ */
+uint64_t sad_nx16_u16_avx2_intrin (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   __m256i s;
+   int i, m;
+
+   __m256i sad = _mm256_setzero_si256();
+   for (i=0; i<n; ) {
+      s = _mm256_setzero_si256();
+      for (m=min(n, i+SAD_U16_BLOCKS); i<m; i++)
+         s = add_absdiff_epu16(s, _mm256_loadu_si256((__m256i *)(p+i*pitch)), _mm256_loadu_si256((__m256i *)(q+i*pitch)));
+      sad = add_epu32_epi64(sad, s);
+   }
+   return hsum_epi64(sad);
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx8 window of 16-bit samples with AVX2
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    8 samples length
+ * @param n        n = len(array)/pitch
+ * @return uint64_t 
+ */
+uint64_t ssd_nx8_u16_avx2_intrin (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   __m256i d;
+   int i;
+
+   __m256i ssd = _mm256_setzero_si256();
+   for (i=0; i+1<n; i+=2) {
+      d = absdiff_epu16(load2_epi16(p+i*pitch, p+(i+1)*pitch), load2_epi16(q+i*pitch, q+(i+1)*pitch));
+      ssd = add_sq_epu16(ssd, d);
+   }
+   if (i < n) {
+      /* odd block: upper half of difference is zero */
+      d = absdiff_epu16(load1_epi16(p+i*pitch), load1_epi16(q+i*pitch));
+      ssd = add_sq_epu16(ssd, d);
+   }
+   return hsum_epi64(ssd);
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx16 window of 16-bit samples with AVX2
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    16 samples length
+ * @param n        n = len(array)/pitch
+ * @return uint64_t 
+ */
+uint64_t ssd_nx16_u16_avx2_intrin (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   __m256i d;
+   int i;
+
+   __m256i ssd = _mm256_setzero_si256();
+   for (i=0; i<n; i++) {
+      d = absdiff_epu16(_mm256_loadu_si256((__m256i *)(p+i*pitch)), _mm256_loadu_si256((__m256i *)(q+i*pitch)));
+      ssd = add_sq_epu16(ssd, d);
+   }
+   return hsum_epi64(ssd);
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one nx16 window of 16-bit samples against two others with AVX2
+ * 
+ * @param p        reference array of data
+ * @param q        2nd array of data
+ * @param r        3rd array of data
+ * @param pitch    16 samples length
+ * @param n        n = len(array)/pitch
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_nx16_u16_avx2_intrin (uint16_t *p, uint16_t *q, uint16_t *r, int pitch, int n, uint64_t *ssd_pq, uint64_t *ssd_pr)
+{
+   __m256i vp;
+   int i;
+
+   __m256i pq = _mm256_setzero_si256();
+   __m256i pr = _mm256_setzero_si256();
+   for (i=0; i<n; i++) {
+      vp = _mm256_loadu_si256((__m256i *)(p+i*pitch));
+      pq = add_sq_epu16(pq, absdiff_epu16(vp, _mm256_loadu_si256((__m256i *)(q+i*pitch))));
+      pr = add_sq_epu16(pr, absdiff_epu16(vp, _mm256_loadu_si256((__m256i *)(r+i*pitch))));
+   }
+   *ssd_pq = hsum_epi64(pq);
+   *ssd_pr = hsum_epi64(pr);
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one row of 16-bit samples against two others with AVX2
+ * 
+ * The last n % 16 samples are compared in the 16-sample block ending the row, masked
+ * as in ssd2_row_u8_avx2_intrin().
+ * 
+ * @param p        reference row
+ * @param q        2nd row
+ * @param r        3rd row
+ * @param n        row length [in samples], any value
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_row_u16_avx2_intrin (uint16_t *p, uint16_t *q, uint16_t *r, int n, uint64_t *ssd_pq, uint64_t *ssd_pr)
+{
+   __m256i m, vp;
+   __m256i pq = _mm256_setzero_si256();
+   __m256i pr = _mm256_setzero_si256();
+   int t = n % 16;
+
+   if (n < 16) {
+      ssd2_row_u16_c(p, q, r, n, ssd_pq, ssd_pr);
+      return;
+   }
+   ssd2_nx16_u16_avx2_intrin(p, q, r, 16, n/16, ssd_pq, ssd_pr);
+   if (t) {
+      p += n - 16, q += n - 16, r += n - 16;
+      m = _mm256_loadu_si256((__m256i *)(tail_mask_u16 + t));
+      vp = _mm256_and_si256(m, _mm256_loadu_si256((__m256i *)p));
+      pq = add_sq_epu16(pq, absdiff_epu16(vp, _mm256_and_si256(m, _mm256_loadu_si256((__m256i *)q))));
+      pr = add_sq_epu16(pr, absdiff_epu16(vp, _mm256_and_si256(m, _mm256_loadu_si256((__m256i *)r))));
+      *ssd_pq += hsum_epi64(pq);
+      *ssd_pr += hsum_epi64(pr);
+   }
+}
+
+/*!
+ * @brief Downscale two rows by averaging 2x2 pixels with AVX2
+ * 
+ * @param a        1st row (2n pixels)
+ * @param b        2nd row (2n pixels)
+ * @param out      output row (n pixels)
+ * @param n        number of output pixels
+ */
+void avg_2x2_u8_avx2_intrin (unsigned char *a, unsigned char *b, unsigned char *out, int n)
+{
+   __m256i v0, v1;
+   int x;
+
+   __m256i mask = _mm256_set1_epi16(0x00FF);
+   for (x=0; x+32<=n; x+=32) {
+      v0 = _mm256_avg_epu8(_mm256_loadu_si256((__m256i *)(a+2*x)), _mm256_loadu_si256((__m256i *)(b+2*x)));
+      v1 = _mm256_avg_epu8(_mm256_loadu_si256((__m256i *)(a+2*x+32)), _mm256_loadu_si256((__m256i *)(b+2*x+32)));
+      v0 = _mm256_avg_epu16(_mm256_and_si256(v0, mask), _mm256_srli_epi16(v0, 8));
+      v1 = _mm256_avg_epu16(_mm256_and_si256(v1, mask), _mm256_srli_epi16(v1, 8));
+      /* packus works within 128-bit lanes: restore pixel order */
+      _mm256_storeu_si256((__m256i *)(out+x), _mm256_permute4x64_epi64(_mm256_packus_epi16(v0, v1), 0xD8));
+   }
+   avg_2x2_u8_sse2_intrin(a+2*x, b+2*x, out+x, n-x);
+}
@@ -0,0 +1,428 @@
+#include <immintrin.h>
+#include <stdio.h>
+
+#include "pattern_detector.h"
+
+#ifndef NON_AVX512_SUPPORT
+
+/*
+ * AVX-512BW kernels: windows are laid out back to back (pitch equal to the window width)
+ * everywhere the detector calls them, so n windows are processed as one contiguous run
+ * of 64-byte vectors, and the last partial vector is loaded with a zero-masked load.
+ * Windows spaced further apart are handed to the AVX2 kernels.
+ */
+
+/* max number of 64-byte vectors summed in 32-bit lanes before widening SAD (up to 2 x 0xFFFF per lane & vector) */
+#define SAD_U16_VECTORS  16384
+
+/*! Mask of the first n bytes (n < 64) */
+static inline __mmask64 tail_mask_u8 (int n)
+{
+   return (__mmask64)((1ULL << n) - 1);
+}
+
+/*! Mask of the first n 16-bit samples (n < 32) */
+static inline __mmask32 tail_mask_u16 (int n)
+{
+   return (__mmask32)((1U << n) - 1);
+}
+
+/*! Add squared differences of unsigned bytes of a & b to 32-bit lanes of acc */
+static inline __m512i add_sq_diff_u8 (__m512i acc, __m512i a, __m512i b)
+{
+   __m512i zeros = _mm512_setzero_si512();
+   __m512i lo = _mm512_sub_epi16(_mm512_unpacklo_epi8(a, zeros), _mm512_unpacklo_epi8(b, zeros));
+   __m512i hi = _mm512_sub_epi16(_mm512_unpackhi_epi8(a, zeros), _mm512_unpackhi_epi8(b, zeros));
+   return _mm512_add_epi32(acc, _mm512_add_epi32(_mm512_madd_epi16(lo, lo), _mm512_madd_epi16(hi, hi)));
+}
+
+/*! SAD of n contiguous bytes */
+static int sad_u8 (unsigned char *p, unsigned char *q, int n)
+{
+   __mmask64 m;
+   int i;
+
+   __m512i sad = _mm512_setzero_si512();
+   for (i=0; i+64<=n; i+=64)
+      sad = _mm512_add_epi64(sad, _mm512_sad_epu8(_mm512_loadu_si512(p+i), _mm512_loadu_si512(q+i)));
+   if (i < n) {
+      m = tail_mask_u8(n - i);
+      sad = _mm512_add_epi64(sad, _mm512_sad_epu8(_mm512_maskz_loadu_epi8(m, p+i), _mm512_maskz_loadu_epi8(m, q+i)));
+   }
+   return (int)_mm512_reduce_add_epi64(sad);
+}
+
+/*! SSD of n contiguous bytes */
+static int ssd_u8 (unsigned char *p, unsigned char *q, int n)
+{
+   __mmask64 m;
+   int i;
+
+   __m512i ssd = _mm512_setzero_si512();
+   for (i=0; i+64<=n; i+=64)
+      ssd = add_sq_diff_u8(ssd, _mm512_loadu_si512(p+i), _mm512_loadu_si512(q+i));
+   if (i < n) {
+      m = tail_mask_u8(n - i);
+      ssd = add_sq_diff_u8(ssd, _mm512_maskz_loadu_epi8(m, p+i), _mm512_maskz_loadu_epi8(m, q+i));
+   }
+   return _mm512_reduce_add_epi32(ssd);
+}
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx8 window with AVX-512BW
+ *
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    8 bytes length
+ * @param n        n = len(array)/pitch
+ * @return int
+ */
+int sad_nx8_u8_avx512_intrin (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   return (pitch == 8)? sad_u8(p, q, 8*n): sad_nx8_u8_avx2_intrin(p, q, pitch, n);
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx8 window with AVX-512BW
+ *
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    8 bytes length
+ * @param n        n = len(array)/pitch
+ * @return int
+ */
+int ssd_nx8_u8_avx512_intrin (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   return (pitch == 8)? ssd_u8(p, q, 8*n): ssd_nx8_u8_avx2_intrin(p, q, pitch, n);
+}
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx16 window with AVX-512BW
+ *
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    16 bytes length
+ * @param n        n = len(array)/pitch
+ * @return int
+ */
+int sad_nx16_u8_avx512_intrin (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   return (pitch == 16)? sad_u8(p, q, 16*n): sad_nx16_u8_avx2_intrin(p, q, pitch, n);
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx16 window with AVX-512BW
+ *
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    16 bytes length
+ * @param n        n = len(array)/pitch
+ * @return int
+ */
+int ssd_nx16_u8_avx512_intrin (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   return (pitch == 16)? ssd_u8(p, q, 16*n): ssd_nx16_u8_avx2_intrin(p, q, pitch, n);
+}
+
+/*! SSDs of n contiguous bytes of p against q & r */
+static void ssd2_u8 (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr)
+{
+   __m512i vp;
+   __mmask64 m;
+   int i;
+
+   __m512i pq = _mm512_setzero_si512();
+   __m512i pr = _mm512_setzero_si512();
+   for (i=0; i+64<=n; i+=64) {
+      vp = _mm512_loadu_si512(p+i);
+      pq = add_sq_diff_u8(pq, vp, _mm512_loadu_si512(q+i));
+      pr = add_sq_diff_u8(pr, vp, _mm512_loadu_si512(r+i));
+   }
+   if (i < n) {
+      m = tail_mask_u8(n - i);
+      vp = _mm512_maskz_loadu_epi8(m, p+i);
+      pq = add_sq_diff_u8(pq, vp, _mm512_maskz_loadu_epi8(m, q+i));
+      pr = add_sq_diff_u8(pr, vp, _mm512_maskz_loadu_epi8(m, r+i));
+   }
+   *ssd_pq = _mm512_reduce_add_epi32(pq);
+   *ssd_pr = _mm512_reduce_add_epi32(pr);
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one nx16 window against two others with AVX-512BW
+ *
+ * @param p        reference array of data
+ * @param q        2nd array of data
+ * @param r        3rd array of data
+ * @param pitch    16 bytes length
+ * @param n        n = len(array)/pitch
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_nx16_u8_avx512_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int pitch, int n, int *ssd_pq, int *ssd_pr)
+{
+   if (pitch == 16)
+      ssd2_u8(p, q, r, 16*n, ssd_pq, ssd_pr);
+   else
+      ssd2_nx16_u8_avx2_intrin(p, q, r, pitch, n, ssd_pq, ssd_pr);
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one row against two others with AVX-512BW, masked tail
+ *
+ * @param p        reference row
+ * @param q        2nd row
+ * @param r        3rd row
+ * @param n        row length [in samples], any value
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_row_u8_avx512_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr)
+{
+   ssd2_u8(p, q, r, n, ssd_pq, ssd_pr);
+}
+
+/* Block row kernel (shared with the VNNI kernels), summing squares with vpmaddwd */
+
+/*! Add squared differences of 16-bit lanes of a & b to 32-bit lanes of acc */
+static inline __m512i add_sq_diff_epi16 (__m512i acc, __m512i a, __m512i b)
+{
+   __m512i d = _mm512_sub_epi16(a, b);
+   return _mm512_add_epi32(acc, _mm512_madd_epi16(d, d));
+}
+
+#include "loss_funcs_avx512_rows.h"
+
+/*!
+ * @brief Accumulate SSDs of a row of statistics blocks against next rows & field partners with AVX-512BW
+ *
+ * See ssd2_rows_u8_c() for parameters.
+ */
+void ssd2_rows_u8_avx512_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1)
+{
+   ssd2_rows_u8(p, stride, width, frame_rows, field_rows, dd_frame, dd_field0, dd_field1, 1);
+}
+
+/*!
+ * @brief ssd2_rows_u8_avx512_intrin() with block sizes at run time only, without the full-block copy (reference for the benchmark)
+ */
+void ssd2_rows_any_u8_avx512_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1)
+{
+   ssd2_rows_u8(p, stride, width, frame_rows, field_rows, dd_frame, dd_field0, dd_field1, 0);
+}
+
+/*
+ * 16-bit sample kernels: as with AVX2, differences are taken as |p - q| with saturating
+ * subtractions, squares are formed from the low & high halves of 16x16-bit products,
+ * and all sums are accumulated in 64-bit lanes.
+ */
+
+/*! |a - b| of unsigned 16-bit lanes */
+static inline __m512i absdiff_epu16 (__m512i a, __m512i b)
+{
+   return _mm512_or_si512(_mm512_subs_epu16(a, b), _mm512_subs_epu16(b, a));
+}
+
+/*! Add unsigned 32-bit lanes of x to 64-bit lanes of acc */
+static inline __m512i add_epu32_epi64 (__m512i acc, __m512i x)
+{
+   acc = _mm512_add_epi64(acc, _mm512_cvtepu32_epi64(_mm512_castsi512_si256(x)));
+   return _mm512_add_epi64(acc, _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(x, 1)));
+}
+
+/*! Add squares of unsigned 16-bit lanes of d to 64-bit lanes of acc */
+static inline __m512i add_sq_epu16 (__m512i acc, __m512i d)
+{
+   __m512i lo = _mm512_mullo_epi16(d, d);
+   __m512i hi = _mm512_mulhi_epu16(d, d);
+   acc = add_epu32_epi64(acc, _mm512_unpacklo_epi16(lo, hi));
+   return add_epu32_epi64(acc, _mm512_unpackhi_epi16(lo, hi));
+}
+
+/*! Add |a - b| of unsigned 16-bit lanes to 32-bit lanes of acc */
+static inline __m512i add_absdiff_epu16 (__m512i acc, __m512i a, __m512i b)
+{
+   __m512i zeros = _mm512_setzero_si512();
+   __m512i d = absdiff_epu16(a, b);
+   return _mm512_add_epi32(acc, _mm512_add_epi32(_mm512_unpacklo_epi16(d, zeros), _mm512_unpackhi_epi16(d, zeros)));
+}
+
+/*! SAD of n contiguous 16-bit samples */
+static uint64_t sad_u16 (uint16_t *p, uint16_t *q, int n)
+{
+   __m512i s;
+   __mmask32 mk;
+   int i, m;
+
+   __m512i sad = _mm512_setzero_si512();
+   for (i=0; i+32<=n; ) {
+      s = _mm512_setzero_si512();
+      for (m=min(n-31, i+32*SAD_U16_VECTORS); i<m; i+=32)
+         s = add_absdiff_epu16(s, _mm512_loadu_si512(p+i), _mm512_loadu_si512(q+i));
+      sad = add_epu32_epi64(sad, s);
+   }
+   if (i < n) {
+      mk = tail_mask_u16(n - i);
+      s = add_absdiff_epu16(_mm512_setzero_si512(), _mm512_maskz_loadu_epi16(mk, p+i), _mm512_maskz_loadu_epi16(mk, q+i));
+      sad = add_epu32_epi64(sad, s);
+   }
+   return (uint64_t)_mm512_reduce_add_epi64(sad);
+}
+
+/*! SSD of n contiguous 16-bit samples */
+static uint64_t ssd_u16 (uint16_t *p, uint16_t *q, int n)
+{
+   __mmask32 m;
+   int i;
+
+   __m512i ssd = _mm512_setzero_si512();
+   for (i=0; i+32<=n; i+=32)
+      ssd = add_sq_epu16(ssd, absdiff_epu16(_mm512_loadu_si512(p+i), _mm512_loadu_si512(q+i)));
+   if (i < n) {
+      m = tail_mask_u16(n - i);
+      ssd = add_sq_epu16(ssd, absdiff_epu16(_mm512_maskz_loadu_epi16(m, p+i), _mm512_maskz_loadu_epi16(m, q+i)));
+   }
+   return (uint64_t)_mm512_reduce_add_epi64(ssd);
+}
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx8 window of 16-bit samples with AVX-512BW
+ *
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    8 samples length
+ * @param n        n = len(array)/pitch
+ * @return uint64_t
+ */
+uint64_t sad_nx8_u16_avx512_intrin (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   return (pitch == 8)? sad_u16(p, q, 8*n): sad_nx8_u16_avx2_intrin(p, q, pitch, n);
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx8 window of 16-bit samples with AVX-512BW
+ *
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    8 samples length
+ * @param n        n = len(array)/pitch
+ * @return uint64_t
+ */
+uint64_t ssd_nx8_u16_avx512_intrin (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   return (pitch == 8)? ssd_u16(p, q, 8*n): ssd_nx8_u16_avx2_intrin(p, q, pitch, n);
+}
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx16 window of 16-bit samples with AVX-512BW
+ *
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    16 samples length
+ * @param n        n = len(array)/pitch
+ * @return uint64_t
+ */
+uint64_t sad_nx16_u16_avx512_intrin (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   return (pitch == 16)? sad_u16(p, q, 16*n): sad_nx16_u16_avx2_intrin(p, q, pitch, n);
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx16 window of 16-bit samples with AVX-512BW
+ *
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    16 samples length
+ * @param n        n = len(array)/pitch
+ * @return uint64_t
+ */
+uint64_t ssd_nx16_u16_avx512_intrin (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   return (pitch == 16)? ssd_u16(p, q, 16*n): ssd_nx16_u16_avx2_intrin(p, q, pitch, n);
+}
+
+/*! SSDs of n contiguous samples of p against q & r */
+static void ssd2_u16 (uint16_t *p, uint16_t *q, uint16_t *r, int n, uint64_t *ssd_pq, uint64_t *ssd_pr)
+{
+   __m512i vp;
+   __mmask32 m;
+   int i;
+
+   __m512i pq = _mm512_setzero_si512();
+   __m512i pr = _mm512_setzero_si512();
+   for (i=0; i+32<=n; i+=32) {
+      vp = _mm512_loadu_si512(p+i);
+      pq = add_sq_epu16(pq, absdiff_epu16(vp, _mm512_loadu_si512(q+i)));
+      pr = add_sq_epu16(pr, absdiff_epu16(vp, _mm512_loadu_si512(r+i)));
+   }
+   if (i < n) {
+      m = tail_mask_u16(n - i);
+      vp = _mm512_maskz_loadu_epi16(m, p+i);
+      pq = add_sq_epu16(pq, absdiff_epu16(vp, _mm512_maskz_loadu_epi16(m, q+i)));
+      pr = add_sq_epu16(pr, absdiff_epu16(vp, _mm512_maskz_loadu_epi16(m, r+i)));
+   }
+   *ssd_pq = (uint64_t)_mm512_reduce_add_epi64(pq);
+   *ssd_pr = (uint64_t)_mm512_reduce_add_epi64(pr);
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one nx16 window of 16-bit samples against two others with AVX-512BW
+ *
+ * @param p        reference array of data
+ * @param q        2nd array of data
+ * @param r        3rd array of data
+ * @param pitch    16 samples length
+ * @param n        n = len(array)/pitch
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_nx16_u16_avx512_intrin (uint16_t *p, uint16_t *q, uint16_t *r, int pitch, int n, uint64_t *ssd_pq, uint64_t *ssd_pr)
+{
+   if (pitch == 16)
+      ssd2_u16(p, q, r, 16*n, ssd_pq, ssd_pr);
+   else
+      ssd2_nx16_u16_avx2_intrin(p, q, r, pitch, n, ssd_pq, ssd_pr);
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one row of 16-bit samples against two others with AVX-512BW, masked tail
+ *
+ * @param p        reference row
+ * @param q        2nd row
+ * @param r        3rd row
+ * @param n        row length [in samples], any value
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_row_u16_avx512_intrin (uint16_t *p, uint16_t *q, uint16_t *r, int n, uint64_t *ssd_pq, uint64_t *ssd_pr)
+{
+   ssd2_u16(p, q, r, n, ssd_pq, ssd_pr);
+}
+
+/*!
+ * @brief Downscale two rows by averaging 2x2 pixels with AVX-512BW
+ *
+ * @param a        1st row (2n pixels)
+ * @param b        2nd row (2n pixels)
+ * @param out      output row (n pixels)
+ * @param n        number of output pixels
+ */
+void avg_2x2_u8_avx512_intrin (unsigned char *a, unsigned char *b, unsigned char *out, int n)
+{
+   __m512i v0, v1;
+   int x;
+
+   __m512i mask = _mm512_set1_epi16(0x00FF);
+   __m512i order = _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7);
+   for (x=0; x+64<=n; x+=64) {
+      v0 = _mm512_avg_epu8(_mm512_loadu_si512(a+2*x), _mm512_loadu_si512(b+2*x));
+      v1 = _mm512_avg_epu8(_mm512_loadu_si512(a+2*x+64), _mm512_loadu_si512(b+2*x+64));
+      v0 = _mm512_avg_epu16(_mm512_and_si512(v0, mask), _mm512_srli_epi16(v0, 8));
+      v1 = _mm512_avg_epu16(_mm512_and_si512(v1, mask), _mm512_srli_epi16(v1, 8));
+      /* packus works within 128-bit lanes: restore pixel order */
+      _mm512_storeu_si512(out+x, _mm512_permutexvar_epi64(order, _mm512_packus_epi16(v0, v1)));
+   }
+   avg_2x2_u8_avx2_intrin(a+2*x, b+2*x, out+x, n-x);
+}
+
+#endif /* NON_AVX512_SUPPORT */
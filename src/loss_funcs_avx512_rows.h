@@ -0,0 +1,158 @@
+/*!
+ *  \file     loss_funcs_avx512_rows.h
+ *  \brief    AVX-512 block row kernel, shared by the AVX-512BW & AVX-512 VNNI kernels
+ *
+ *  Included by loss_funcs_avx512.c and loss_funcs_avx512vnni.c, which define before it
+ *  tail_mask_u8() and add_sq_diff_epi16(), the sum of squares of 16-bit differences
+ *  (vpmaddwd & add, or vpdpwssd), and implement their kernels with ssd2_rows_u8().
+ *
+ */
+
+#ifndef _LOSS_FUNCS_AVX512_ROWS_H_
+#define _LOSS_FUNCS_AVX512_ROWS_H_
+
+/*
+ * Block row kernel, as with AVX2, on strips of up to 64 bytes of a statistics block
+ * loaded with zero-masked loads, so that blocks of any width take no tail code. Full
+ * blocks take a copy with strips & rows known at compile time, rows unrolled, and the
+ * last 32 bytes of the block widened into one register instead of a half-masked strip.
+ */
+
+/*! Accumulators of one statistics block */
+typedef struct {
+   __m512i frame_lo, frame_hi;
+   __m512i field_lo[2], field_hi[2];    //!< rows of even & odd index
+} rows_acc_t;
+
+/*! Load bytes of row selected by m as 16-bit lanes lo & hi */
+static inline void load_row_u8 (const unsigned char *row, __mmask64 m, __m512i *lo, __m512i *hi)
+{
+   __m512i v = _mm512_maskz_loadu_epi8(m, row);
+   *lo = _mm512_unpacklo_epi8(v, _mm512_setzero_si512());
+   *hi = _mm512_unpackhi_epi8(v, _mm512_setzero_si512());
+}
+
+/*! Compare row a against next row b & field partner c, field sums to accumulators of rows of parity f */
+static inline __attribute__((always_inline)) void ssd2_step_u8 (rows_acc_t *acc, int f, __m512i a_lo, __m512i a_hi, __m512i b_lo, __m512i b_hi, __m512i c_lo, __m512i c_hi)
+{
+   acc->frame_lo = add_sq_diff_epi16(acc->frame_lo, a_lo, b_lo);
+   acc->frame_hi = add_sq_diff_epi16(acc->frame_hi, a_hi, b_hi);
+   acc->field_lo[f] = add_sq_diff_epi16(acc->field_lo[f], a_lo, c_lo);
+   acc->field_hi[f] = add_sq_diff_epi16(acc->field_hi[f], a_hi, c_hi);
+}
+
+/*! Accumulate one strip of bytes selected by m down frame_rows rows, of which field_rows have a field partner */
+static inline __attribute__((always_inline)) void ssd2_strip_u8 (unsigned char *p, int stride, __mmask64 m, int frame_rows, int field_rows, rows_acc_t *acc)
+{
+   __m512i a_lo, a_hi, b_lo, b_hi, c_lo, c_hi, d_lo, d_hi;
+   int k;
+
+   load_row_u8(p, m, &a_lo, &a_hi);
+   load_row_u8(p + stride, m, &b_lo, &b_hi);
+   /* rows by pairs, so that even & odd rows add to their own field accumulators */
+   for (k=0; k+2<=field_rows; k+=2) {
+      load_row_u8(p + (size_t)(k+2)*stride, m, &c_lo, &c_hi);
+      load_row_u8(p + (size_t)(k+3)*stride, m, &d_lo, &d_hi);
+      ssd2_step_u8(acc, 0, a_lo, a_hi, b_lo, b_hi, c_lo, c_hi);
+      ssd2_step_u8(acc, 1, b_lo, b_hi, c_lo, c_hi, d_lo, d_hi);
+      a_lo = c_lo, a_hi = c_hi;
+      b_lo = d_lo, b_hi = d_hi;
+   }
+   if (k < field_rows) {
+      load_row_u8(p + (size_t)(k+2)*stride, m, &c_lo, &c_hi);
+      ssd2_step_u8(acc, 0, a_lo, a_hi, b_lo, b_hi, c_lo, c_hi);
+      a_lo = b_lo, a_hi = b_hi;
+      b_lo = c_lo, b_hi = c_hi;
+      k++;
+   }
+   for (; k<frame_rows; k++) {
+      acc->frame_lo = add_sq_diff_epi16(acc->frame_lo, a_lo, b_lo);
+      acc->frame_hi = add_sq_diff_epi16(acc->frame_hi, a_hi, b_hi);
+      if (k+1 < frame_rows) {
+         a_lo = b_lo, a_hi = b_hi;
+         load_row_u8(p + (size_t)(k+2)*stride, m, &b_lo, &b_hi);
+      }
+   }
+}
+
+/*! Load 64 bytes of row as 16-bit lanes lo & hi (w == 64), or 32 bytes as lo (w == 32) */
+static inline __attribute__((always_inline)) void load_full_row_u8 (const unsigned char *row, int w, __m512i *lo, __m512i *hi)
+{
+   if (w == 64)
+      load_row_u8(row, ~(__mmask64)0, lo, hi);
+   else
+      *lo = _mm512_cvtepu8_epi16(_mm256_loadu_si256((__m256i *)row));
+}
+
+/*! Compare row a against next row b & field partner c on w bytes (see load_full_row_u8()), field sums to accumulators of rows of parity f */
+static inline __attribute__((always_inline)) void ssd2_full_step_u8 (rows_acc_t *acc, int w, int f, __m512i a_lo, __m512i a_hi, __m512i b_lo, __m512i b_hi, __m512i c_lo, __m512i c_hi)
+{
+   acc->frame_lo = add_sq_diff_epi16(acc->frame_lo, a_lo, b_lo);
+   acc->field_lo[f] = add_sq_diff_epi16(acc->field_lo[f], a_lo, c_lo);
+   if (w == 64) {
+      acc->frame_hi = add_sq_diff_epi16(acc->frame_hi, a_hi, b_hi);
+      acc->field_hi[f] = add_sq_diff_epi16(acc->field_hi[f], a_hi, c_hi);
+   }
+}
+
+/*! Accumulate one strip of w bytes (64 or 32) down BLOCK_HEIGHT rows (even) that all have a field partner, rows unrolled */
+static inline __attribute__((always_inline)) void ssd2_full_strip_u8 (unsigned char *p, int stride, int w, rows_acc_t *acc)
+{
+   __m512i a_lo, a_hi, b_lo, b_hi, c_lo, c_hi, d_lo, d_hi;
+   int k;
+
+   a_hi = b_hi = c_hi = d_hi = _mm512_setzero_si512();
+   load_full_row_u8(p, w, &a_lo, &a_hi);
+   load_full_row_u8(p + stride, w, &b_lo, &b_hi);
+#pragma GCC unroll 16
+   for (k=0; k<BLOCK_HEIGHT; k+=2) {
+      load_full_row_u8(p + (size_t)(k+2)*stride, w, &c_lo, &c_hi);
+      load_full_row_u8(p + (size_t)(k+3)*stride, w, &d_lo, &d_hi);
+      ssd2_full_step_u8(acc, w, 0, a_lo, a_hi, b_lo, b_hi, c_lo, c_hi);
+      ssd2_full_step_u8(acc, w, 1, b_lo, b_hi, c_lo, c_hi, d_lo, d_hi);
+      a_lo = c_lo, a_hi = c_hi;
+      b_lo = d_lo, b_hi = d_hi;
+   }
+}
+
+/*!
+ * Accumulate a full block, BLOCK_WIDTH bytes (a multiple of 32) of BLOCK_HEIGHT rows (even)
+ * that all have a field partner: 64-byte strips, then a last 32-byte strip if any, widened
+ * into one register instead of a half-masked strip, rows unrolled
+ */
+static inline __attribute__((always_inline)) void ssd2_full_block_u8 (unsigned char *p, int stride, rows_acc_t *acc)
+{
+   int x;
+
+   for (x=0; x+64<=BLOCK_WIDTH; x+=64)
+      ssd2_full_strip_u8(p+x, stride, 64, acc);
+   if (x < BLOCK_WIDTH)
+      ssd2_full_strip_u8(p+x, stride, 32, acc);
+}
+
+/*! Block row kernel, with the full-block copy if full_blocks */
+static inline __attribute__((always_inline)) void ssd2_rows_u8 (unsigned char *p, int stride, int width, int frame_rows, int field_rows,
+                                                                uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1, int full_blocks)
+{
+   rows_acc_t acc;
+   int c, j, x, n;
+
+   for (c=0, j=0; j<width; c++, j+=BLOCK_WIDTH) {
+      n = min(BLOCK_WIDTH, width - j);
+      acc.frame_lo = acc.frame_hi = _mm512_setzero_si512();
+      acc.field_lo[0] = acc.field_hi[0] = acc.field_lo[1] = acc.field_hi[1] = _mm512_setzero_si512();
+      if (full_blocks && BLOCK_WIDTH % 32 == 0 && BLOCK_HEIGHT % 2 == 0 && n == BLOCK_WIDTH && field_rows == BLOCK_HEIGHT) {
+         ssd2_full_block_u8(p+j, stride, &acc);
+      } else {
+         for (x=0; x+64<=n; x+=64)
+            ssd2_strip_u8(p+j+x, stride, ~(__mmask64)0, frame_rows, field_rows, &acc);
+         if (x < n)
+            ssd2_strip_u8(p+j+x, stride, tail_mask_u8(n - x), frame_rows, field_rows, &acc);
+      }
+      dd_frame[c] += (uint32_t)_mm512_reduce_add_epi32(_mm512_add_epi32(acc.frame_lo, acc.frame_hi));
+      dd_field0[c] += (uint32_t)_mm512_reduce_add_epi32(_mm512_add_epi32(acc.field_lo[0], acc.field_hi[0]));
+      dd_field1[c] += (uint32_t)_mm512_reduce_add_epi32(_mm512_add_epi32(acc.field_lo[1], acc.field_hi[1]));
+   }
+}
+
+#endif /* _LOSS_FUNCS_AVX512_ROWS_H_ */
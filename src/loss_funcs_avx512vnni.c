@@ -0,0 +1,161 @@
+#include <immintrin.h>
+#include <stdio.h>
+
+#include "pattern_detector.h"
+
+#ifndef NON_AVX512_SUPPORT
+
+/*
+ * AVX-512 VNNI kernels: 8-bit SSD kernels, including the block row kernel used for all
+ * full-resolution 8-bit analysis, with squares of 16-bit differences summed by vpdpwssd
+ * (multiply, add pairs & accumulate in one instruction). Other kernels of the VNNI
+ * table are the AVX-512BW ones.
+ */
+
+/*! Mask of the first n bytes (n < 64) */
+static inline __mmask64 tail_mask_u8 (int n)
+{
+   return (__mmask64)((1ULL << n) - 1);
+}
+
+/*! Add squared differences of unsigned bytes of a & b to 32-bit lanes of acc */
+static inline __m512i add_sq_diff_u8 (__m512i acc, __m512i a, __m512i b)
+{
+   __m512i zeros = _mm512_setzero_si512();
+   __m512i lo = _mm512_sub_epi16(_mm512_unpacklo_epi8(a, zeros), _mm512_unpacklo_epi8(b, zeros));
+   __m512i hi = _mm512_sub_epi16(_mm512_unpackhi_epi8(a, zeros), _mm512_unpackhi_epi8(b, zeros));
+   return _mm512_dpwssd_epi32(_mm512_dpwssd_epi32(acc, lo, lo), hi, hi);
+}
+
+/*! SSD of n contiguous bytes */
+static int ssd_u8 (unsigned char *p, unsigned char *q, int n)
+{
+   __mmask64 m;
+   int i;
+
+   __m512i ssd = _mm512_setzero_si512();
+   for (i=0; i+64<=n; i+=64)
+      ssd = add_sq_diff_u8(ssd, _mm512_loadu_si512(p+i), _mm512_loadu_si512(q+i));
+   if (i < n) {
+      m = (__mmask64)((1ULL << (n - i)) - 1);
+      ssd = add_sq_diff_u8(ssd, _mm512_maskz_loadu_epi8(m, p+i), _mm512_maskz_loadu_epi8(m, q+i));
+   }
+   return _mm512_reduce_add_epi32(ssd);
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx8 window with AVX-512 VNNI
+ *
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    8 bytes length
+ * @param n        n = len(array)/pitch
+ * @return int
+ */
+int ssd_nx8_u8_avx512vnni_intrin (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   return (pitch == 8)? ssd_u8(p, q, 8*n): ssd_nx8_u8_avx2_intrin(p, q, pitch, n);
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx16 window with AVX-512 VNNI
+ *
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    16 bytes length
+ * @param n        n = len(array)/pitch
+ * @return int
+ */
+int ssd_nx16_u8_avx512vnni_intrin (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   return (pitch == 16)? ssd_u8(p, q, 16*n): ssd_nx16_u8_avx2_intrin(p, q, pitch, n);
+}
+
+/*! SSDs of n contiguous bytes of p against q & r */
+static void ssd2_u8 (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr)
+{
+   __m512i vp;
+   __mmask64 m;
+   int i;
+
+   __m512i pq = _mm512_setzero_si512();
+   __m512i pr = _mm512_setzero_si512();
+   for (i=0; i+64<=n; i+=64) {
+      vp = _mm512_loadu_si512(p+i);
+      pq = add_sq_diff_u8(pq, vp, _mm512_loadu_si512(q+i));
+      pr = add_sq_diff_u8(pr, vp, _mm512_loadu_si512(r+i));
+   }
+   if (i < n) {
+      m = (__mmask64)((1ULL << (n - i)) - 1);
+      vp = _mm512_maskz_loadu_epi8(m, p+i);
+      pq = add_sq_diff_u8(pq, vp, _mm512_maskz_loadu_epi8(m, q+i));
+      pr = add_sq_diff_u8(pr, vp, _mm512_maskz_loadu_epi8(m, r+i));
+   }
+   *ssd_pq = _mm512_reduce_add_epi32(pq);
+   *ssd_pr = _mm512_reduce_add_epi32(pr);
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one nx16 window against two others with AVX-512 VNNI
+ *
+ * @param p        reference array of data
+ * @param q        2nd array of data
+ * @param r        3rd array of data
+ * @param pitch    16 bytes length
+ * @param n        n = len(array)/pitch
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_nx16_u8_avx512vnni_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int pitch, int n, int *ssd_pq, int *ssd_pr)
+{
+   if (pitch == 16)
+      ssd2_u8(p, q, r, 16*n, ssd_pq, ssd_pr);
+   else
+      ssd2_nx16_u8_avx2_intrin(p, q, r, pitch, n, ssd_pq, ssd_pr);
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one row against two others with AVX-512 VNNI, masked tail
+ *
+ * @param p        reference row
+ * @param q        2nd row
+ * @param r        3rd row
+ * @param n        row length [in samples], any value
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_row_u8_avx512vnni_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr)
+{
+   ssd2_u8(p, q, r, n, ssd_pq, ssd_pr);
+}
+
+/* Block row kernel (shared with the AVX-512BW kernels), summing squares with vpdpwssd */
+
+/*! Add squared differences of 16-bit lanes of a & b to 32-bit lanes of acc */
+static inline __m512i add_sq_diff_epi16 (__m512i acc, __m512i a, __m512i b)
+{
+   __m512i d = _mm512_sub_epi16(a, b);
+   return _mm512_dpwssd_epi32(acc, d, d);
+}
+
+#include "loss_funcs_avx512_rows.h"
+
+/*!
+ * @brief Accumulate SSDs of a row of statistics blocks against next rows & field partners with AVX-512 VNNI
+ *
+ * See ssd2_rows_u8_c() for parameters.
+ */
+void ssd2_rows_u8_avx512vnni_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1)
+{
+   ssd2_rows_u8(p, stride, width, frame_rows, field_rows, dd_frame, dd_field0, dd_field1, 1);
+}
+
+/*!
+ * @brief ssd2_rows_u8_avx512vnni_intrin() with block sizes at run time only, without the full-block copy (reference for the benchmark)
+ */
+void ssd2_rows_any_u8_avx512vnni_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1)
+{
+   ssd2_rows_u8(p, stride, width, frame_rows, field_rows, dd_frame, dd_field0, dd_field1, 0);
+}
+
+#endif /* NON_AVX512_SUPPORT */
@@ -0,0 +1,310 @@
+#include <stdlib.h>
+
+#include "pattern_detector.h"
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx8 window in C
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    step between consecutive 8-byte blocks
+ * @param n        number of blocks
+ * @return int 
+ */
+int sad_nx8_u8_c (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   int i, k, sad = 0;
+   for (i=0; i<n; i++, p+=pitch, q+=pitch)
+      for (k=0; k<8; k++)
+         sad += abs(p[k] - q[k]);
+   return sad;
+}
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx16 window in C
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    step between consecutive 16-byte blocks
+ * @param n        number of blocks
+ * @return int 
+ */
+int sad_nx16_u8_c (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   int i, k, sad = 0;
+   for (i=0; i<n; i++, p+=pitch, q+=pitch)
+      for (k=0; k<16; k++)
+         sad += abs(p[k] - q[k]);
+   return sad;
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx8 window in C
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    step between consecutive 8-byte blocks
+ * @param n        number of blocks
+ * @return int 
+ */
+int ssd_nx8_u8_c (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   int i, k, d, ssd = 0;
+   for (i=0; i<n; i++, p+=pitch, q+=pitch)
+      for (k=0; k<8; k++) {
+         d = p[k] - q[k];
+         ssd += d * d;
+      }
+   return ssd;
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx16 window in C
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    step between consecutive 16-byte blocks
+ * @param n        number of blocks
+ * @return int 
+ */
+int ssd_nx16_u8_c (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   int i, k, d, ssd = 0;
+   for (i=0; i<n; i++, p+=pitch, q+=pitch)
+      for (k=0; k<16; k++) {
+         d = p[k] - q[k];
+         ssd += d * d;
+      }
+   return ssd;
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one nx16 window against two others in C
+ * 
+ * @param p        reference array of data
+ * @param q        2nd array of data
+ * @param r        3rd array of data
+ * @param pitch    step between consecutive 16-byte blocks
+ * @param n        number of blocks
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_nx16_u8_c (unsigned char *p, unsigned char *q, unsigned char *r, int pitch, int n, int *ssd_pq, int *ssd_pr)
+{
+   int i, k, d, e, pq = 0, pr = 0;
+   for (i=0; i<n; i++, p+=pitch, q+=pitch, r+=pitch)
+      for (k=0; k<16; k++) {
+         d = p[k] - q[k];
+         e = p[k] - r[k];
+         pq += d * d;
+         pr += e * e;
+      }
+   *ssd_pq = pq;
+   *ssd_pr = pr;
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one row against two others in C
+ * 
+ * @param p        reference row
+ * @param q        2nd row
+ * @param r        3rd row
+ * @param n        row length [in samples], any value
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_row_u8_c (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr)
+{
+   int k, d, e, pq = 0, pr = 0;
+   for (k=0; k<n; k++) {
+      d = p[k] - q[k];
+      e = p[k] - r[k];
+      pq += d * d;
+      pr += e * e;
+   }
+   *ssd_pq = pq;
+   *ssd_pr = pr;
+}
+
+/*!
+ * @brief Accumulate SSDs of a row of statistics blocks against next rows & field partners in C
+ * 
+ * Row k (k < frame_rows) is compared against row k+1, and also against row k+2 if
+ * k < field_rows. Sums of each block of BLOCK_WIDTH columns are added to dd_frame[c],
+ * and field sums to dd_field0[c] (even k) or dd_field1[c] (odd k).
+ * 
+ * @param p          first row
+ * @param stride     distance between rows [in bytes]
+ * @param width      row length [in samples], any value
+ * @param frame_rows number of rows compared against their next row, at most BLOCK_HEIGHT
+ * @param field_rows number of rows compared against their field partner, at most frame_rows
+ * @param dd_frame   frame SSDs, one per block
+ * @param dd_field0  field SSDs of even rows, one per block
+ * @param dd_field1  field SSDs of odd rows, one per block
+ */
+void ssd2_rows_u8_c (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1)
+{
+   int k, c, j, ssd_pq, ssd_pr;
+   for (k=0; k<frame_rows; k++, p+=stride)
+      for (c=0, j=0; j<width; c++, j+=BLOCK_WIDTH) {
+         ssd2_row_u8_c(p+j, p+j + stride, p+j + ((k < field_rows)? 2: 1)*stride, min(BLOCK_WIDTH, width - j), &ssd_pq, &ssd_pr);
+         dd_frame[c] += ssd_pq;
+         if (k < field_rows)
+            ((k & 1)? dd_field1: dd_field0)[c] += ssd_pr;
+      }
+}
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx8 window of 16-bit samples in C
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    step between consecutive 8-sample blocks [in samples]
+ * @param n        number of blocks
+ * @return uint64_t 
+ */
+uint64_t sad_nx8_u16_c (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   int i, k;
+   uint64_t sad = 0;
+   for (i=0; i<n; i++, p+=pitch, q+=pitch)
+      for (k=0; k<8; k++)
+         sad += abs(p[k] - q[k]);
+   return sad;
+}
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx16 window of 16-bit samples in C
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    step between consecutive 16-sample blocks [in samples]
+ * @param n        number of blocks
+ * @return uint64_t 
+ */
+uint64_t sad_nx16_u16_c (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   int i, k;
+   uint64_t sad = 0;
+   for (i=0; i<n; i++, p+=pitch, q+=pitch)
+      for (k=0; k<16; k++)
+         sad += abs(p[k] - q[k]);
+   return sad;
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx8 window of 16-bit samples in C
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    step between consecutive 8-sample blocks [in samples]
+ * @param n        number of blocks
+ * @return uint64_t 
+ */
+uint64_t ssd_nx8_u16_c (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   int i, k;
+   uint32_t d;
+   uint64_t ssd = 0;
+   for (i=0; i<n; i++, p+=pitch, q+=pitch)
+      for (k=0; k<8; k++) {
+         d = abs(p[k] - q[k]);
+         ssd += d * d;      // squares of 16-bit differences fit in 32 bits
+      }
+   return ssd;
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx16 window of 16-bit samples in C
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    step between consecutive 16-sample blocks [in samples]
+ * @param n        number of blocks
+ * @return uint64_t 
+ */
+uint64_t ssd_nx16_u16_c (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   int i, k;
+   uint32_t d;
+   uint64_t ssd = 0;
+   for (i=0; i<n; i++, p+=pitch, q+=pitch)
+      for (k=0; k<16; k++) {
+         d = abs(p[k] - q[k]);
+         ssd += d * d;
+      }
+   return ssd;
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one nx16 window of 16-bit samples against two others in C
+ * 
+ * @param p        reference array of data
+ * @param q        2nd array of data
+ * @param r        3rd array of data
+ * @param pitch    step between consecutive 16-sample blocks [in samples]
+ * @param n        number of blocks
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_nx16_u16_c (uint16_t *p, uint16_t *q, uint16_t *r, int pitch, int n, uint64_t *ssd_pq, uint64_t *ssd_pr)
+{
+   int i, k;
+   uint32_t d, e;
+   uint64_t pq = 0, pr = 0;
+   for (i=0; i<n; i++, p+=pitch, q+=pitch, r+=pitch)
+      for (k=0; k<16; k++) {
+         d = abs(p[k] - q[k]);
+         e = abs(p[k] - r[k]);
+         pq += d * d;
+         pr += e * e;
+      }
+   *ssd_pq = pq;
+   *ssd_pr = pr;
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one row of 16-bit samples against two others in C
+ * 
+ * @param p        reference row
+ * @param q        2nd row
+ * @param r        3rd row
+ * @param n        row length [in samples], any value
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_row_u16_c (uint16_t *p, uint16_t *q, uint16_t *r, int n, uint64_t *ssd_pq, uint64_t *ssd_pr)
+{
+   int k;
+   uint32_t d, e;
+   uint64_t pq = 0, pr = 0;
+   for (k=0; k<n; k++) {
+      d = abs(p[k] - q[k]);
+      e = abs(p[k] - r[k]);
+      pq += d * d;
+      pr += e * e;
+   }
+   *ssd_pq = pq;
+   *ssd_pr = pr;
+}
+
+/*!
+ * @brief Downscale two rows by averaging 2x2 pixels in C
+ * 
+ * Pixels are averaged vertically, then horizontally, rounding up at each step
+ * (same as pavgb), so that all implementations produce identical output.
+ * 
+ * @param a        1st row (2n pixels)
+ * @param b        2nd row (2n pixels)
+ * @param out      output row (n pixels)
+ * @param n        number of output pixels
+ */
+void avg_2x2_u8_c (unsigned char *a, unsigned char *b, unsigned char *out, int n)
+{
+   int x, u, v;
+   for (x=0; x<n; x++) {
+      u = (a[2*x] + b[2*x] + 1) >> 1;
+      v = (a[2*x+1] + b[2*x+1] + 1) >> 1;
+      out[x] = (unsigned char)((u + v + 1) >> 1);
+   }
+}
@@ -0,0 +1,567 @@
+#include <emmintrin.h>
+#include <stdio.h>
+
+#include "pattern_detector.h"
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx8 window with SSE2
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    8 bytes length
+ * @param n        n = len(array)/pitch
+ * @return int 
+ */
+int sad_nx8_u8_sse2_intrin (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   __m128i vp, vq;
+   int i;
+
+   __m128i sad = _mm_setzero_si128();
+   for (i=0; i<n; i++) {
+      vp = _mm_loadl_epi64((__m128i *)(p+i*pitch));
+      vq = _mm_loadl_epi64((__m128i *)(q+i*pitch));
+      sad = _mm_add_epi32(sad, _mm_sad_epu8(vp, vq));
+   }
+
+   return _mm_cvtsi128_si32(sad);
+}
+
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx16 window with SSE2
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    16 bytes length
+ * @param n        n = len(array)/pitch
+ * @return int 
+ */
+int sad_nx16_u8_sse2_intrin (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   __m128i vp, vq;
+   int i;
+
+   __m128i sad = _mm_setzero_si128();
+   for (i=0; i<n; i++) {
+      vp = _mm_loadu_si128((__m128i *)(p+i*pitch));
+      vq = _mm_loadu_si128((__m128i *)(q+i*pitch));
+      sad = _mm_add_epi32(sad, _mm_sad_epu8(vp, vq));
+   }
+
+   sad = _mm_add_epi32(sad, _mm_srli_si128(sad, 8));
+   return _mm_cvtsi128_si32(sad);
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx8 window with SSE2
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    8 bytes length
+ * @param n        n = len(array)/pitch
+ * @return int 
+ */
+int ssd_nx8_u8_sse2_intrin (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   __m128i vp, vq, va;
+   int i;
+
+   __m128i zeros = _mm_setzero_si128();
+   __m128i ssd = _mm_setzero_si128();
+   for (i=0; i<n; i++) {
+      vp = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(p+i*pitch)), zeros);
+      vq = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)(q+i*pitch)), zeros);
+      va = _mm_sub_epi16(vp, vq);
+      ssd = _mm_add_epi32(ssd, _mm_madd_epi16(va, va));
+   }
+
+   ssd = _mm_add_epi32(ssd, _mm_srli_si128(ssd, 8));
+   ssd = _mm_add_epi32(ssd, _mm_srli_si128(ssd, 4));
+   return _mm_cvtsi128_si32(ssd);
+}
+
+
+/*!
+ * @brief Calcalute sum of squared difference between nx16 window with SSE2
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    16 bytes length
+ * @param n        n = len(array)/pitch
+ * @return int 
+ */
+int ssd_nx16_u8_sse2_intrin (unsigned char *p, unsigned char *q, int pitch, int n)
+{
+   __m128i a, b, va, va1;
+   int i;
+
+   __m128i zeros = _mm_setzero_si128();
+   __m128i ssd = _mm_setzero_si128();
+   for (i=0; i<n; i++) {
+      a = _mm_loadu_si128((__m128i *)(p+i*pitch));
+      b = _mm_loadu_si128((__m128i *)(q+i*pitch));
+
+      va = _mm_sub_epi16(_mm_unpacklo_epi8(a, zeros), _mm_unpacklo_epi8(b, zeros));
+      va1 = _mm_sub_epi16(_mm_unpackhi_epi8(a, zeros), _mm_unpackhi_epi8(b, zeros));
+
+      ssd = _mm_add_epi32(ssd, _mm_add_epi32(_mm_madd_epi16(va, va), _mm_madd_epi16(va1, va1)));
+   }
+
+   ssd = _mm_add_epi32(ssd, _mm_srli_si128(ssd, 8));
+   ssd = _mm_add_epi32(ssd, _mm_srli_si128(ssd, 4));
+   return _mm_cvtsi128_si32(ssd);
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one nx16 window against two others with SSE2
+ * 
+ * Each block of p is loaded once and compared against q and r, so that the
+ * frame (i vs i+1) and field (i vs i+2) row differences are computed in one pass.
+ * 
+ * @param p        reference array of data
+ * @param q        2nd array of data
+ * @param r        3rd array of data
+ * @param pitch    16 bytes length
+ * @param n        n = len(array)/pitch
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_nx16_u8_sse2_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int pitch, int n, int *ssd_pq, int *ssd_pr)
+{
+   __m128i a, b, c, vp, vp1, va, va1;
+   int i;
+
+   __m128i zeros = _mm_setzero_si128();
+   __m128i pq = _mm_setzero_si128();
+   __m128i pr = _mm_setzero_si128();
+   for (i=0; i<n; i++) {
+      a = _mm_loadu_si128((__m128i *)(p+i*pitch));
+      b = _mm_loadu_si128((__m128i *)(q+i*pitch));
+      c = _mm_loadu_si128((__m128i *)(r+i*pitch));
+      vp = _mm_unpacklo_epi8(a, zeros);
+      vp1 = _mm_unpackhi_epi8(a, zeros);
+
+      va = _mm_sub_epi16(vp, _mm_unpacklo_epi8(b, zeros));
+      va1 = _mm_sub_epi16(vp1, _mm_unpackhi_epi8(b, zeros));
+      pq = _mm_add_epi32(pq, _mm_add_epi32(_mm_madd_epi16(va, va), _mm_madd_epi16(va1, va1)));
+
+      va = _mm_sub_epi16(vp, _mm_unpacklo_epi8(c, zeros));
+      va1 = _mm_sub_epi16(vp1, _mm_unpackhi_epi8(c, zeros));
+      pr = _mm_add_epi32(pr, _mm_add_epi32(_mm_madd_epi16(va, va), _mm_madd_epi16(va1, va1)));
+   }
+
+   pq = _mm_add_epi32(pq, _mm_srli_si128(pq, 8));
+   pq = _mm_add_epi32(pq, _mm_srli_si128(pq, 4));
+   pr = _mm_add_epi32(pr, _mm_srli_si128(pr, 8));
+   pr = _mm_add_epi32(pr, _mm_srli_si128(pr, 4));
+   *ssd_pq = _mm_cvtsi128_si32(pq);
+   *ssd_pr = _mm_cvtsi128_si32(pr);
+}
+
+/* lane masks of row tails: 16 bytes loaded at offset t keep the last t lanes */
+static const unsigned char tail_mask_u8[32] = {
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+static const uint16_t tail_mask_u16[32] = {
+   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+   0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF
+};
+
+/*! SSD of two vectors of 16 bytes */
+static inline int ssd_epu8 (__m128i a, __m128i b)
+{
+   __m128i zeros = _mm_setzero_si128();
+   __m128i va = _mm_sub_epi16(_mm_unpacklo_epi8(a, zeros), _mm_unpacklo_epi8(b, zeros));
+   __m128i va1 = _mm_sub_epi16(_mm_unpackhi_epi8(a, zeros), _mm_unpackhi_epi8(b, zeros));
+   __m128i ssd = _mm_add_epi32(_mm_madd_epi16(va, va), _mm_madd_epi16(va1, va1));
+
+   ssd = _mm_add_epi32(ssd, _mm_srli_si128(ssd, 8));
+   ssd = _mm_add_epi32(ssd, _mm_srli_si128(ssd, 4));
+   return _mm_cvtsi128_si32(ssd);
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one row against two others with SSE2
+ * 
+ * Whole 16-byte blocks go through the nx16 kernel. The last n % 16 bytes are compared
+ * in the 16-byte block ending the row, with its lanes already counted masked out, so
+ * that nothing is read past the row.
+ * 
+ * @param p        reference row
+ * @param q        2nd row
+ * @param r        3rd row
+ * @param n        row length [in samples], any value
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_row_u8_sse2_intrin (unsigned char *p, unsigned char *q, unsigned char *r, int n, int *ssd_pq, int *ssd_pr)
+{
+   __m128i m, vp;
+   int t = n % 16;
+
+   if (n < 16) {
+      ssd2_row_u8_c(p, q, r, n, ssd_pq, ssd_pr);
+      return;
+   }
+   ssd2_nx16_u8_sse2_intrin(p, q, r, 16, n/16, ssd_pq, ssd_pr);
+   if (t) {
+      p += n - 16, q += n - 16, r += n - 16;
+      m = _mm_loadu_si128((__m128i *)(tail_mask_u8 + t));
+      vp = _mm_and_si128(m, _mm_loadu_si128((__m128i *)p));
+      *ssd_pq += ssd_epu8(vp, _mm_and_si128(m, _mm_loadu_si128((__m128i *)q)));
+      *ssd_pr += ssd_epu8(vp, _mm_and_si128(m, _mm_loadu_si128((__m128i *)r)));
+   }
+}
+
+/*
+ * Block row kernel, as with AVX2: each 16-byte strip of a statistics block is walked
+ * down the rows, each row loaded & widened once, with sums reduced once per block. There
+ * is no full-block copy: with 16-byte strips, one compiled for the block size is no
+ * faster, the kernel being bound by widening & multiplies rather than loop overhead.
+ */
+
+/*! Accumulators of one statistics block */
+typedef struct {
+   __m128i frame_lo, frame_hi;
+   __m128i field_lo[2], field_hi[2];    //!< rows of even & odd index
+} rows_acc_t;
+
+/*! Load 16 bytes of row (masked to the last t bytes if t < 16) as 16-bit lanes lo & hi */
+static inline __attribute__((always_inline)) void load_row_u8 (const unsigned char *row, int t, __m128i *lo, __m128i *hi)
+{
+   __m128i v = _mm_loadu_si128((__m128i *)row);
+
+   if (t < 16)
+      v = _mm_and_si128(_mm_loadu_si128((__m128i *)(tail_mask_u8 + t)), v);
+   *lo = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+   *hi = _mm_unpackhi_epi8(v, _mm_setzero_si128());
+}
+
+/*! Add squared differences of 16-bit lanes of a & b to 32-bit lanes of acc */
+static inline __m128i add_sq_diff_epi16 (__m128i acc, __m128i a, __m128i b)
+{
+   __m128i d = _mm_sub_epi16(a, b);
+   return _mm_add_epi32(acc, _mm_madd_epi16(d, d));
+}
+
+/*! Compare row a against next row b & field partner c, field sums to accumulators of rows of parity f */
+static inline __attribute__((always_inline)) void ssd2_step_u8 (rows_acc_t *acc, int f, __m128i a_lo, __m128i a_hi, __m128i b_lo, __m128i b_hi, __m128i c_lo, __m128i c_hi)
+{
+   acc->frame_lo = add_sq_diff_epi16(acc->frame_lo, a_lo, b_lo);
+   acc->frame_hi = add_sq_diff_epi16(acc->frame_hi, a_hi, b_hi);
+   acc->field_lo[f] = add_sq_diff_epi16(acc->field_lo[f], a_lo, c_lo);
+   acc->field_hi[f] = add_sq_diff_epi16(acc->field_hi[f], a_hi, c_hi);
+}
+
+/*! Accumulate one strip of 16 bytes (last t of them) down frame_rows rows, of which field_rows have a field partner */
+static inline __attribute__((always_inline)) void ssd2_strip_u8 (unsigned char *p, int stride, int t, int frame_rows, int field_rows, rows_acc_t *acc)
+{
+   __m128i a_lo, a_hi, b_lo, b_hi, c_lo, c_hi, d_lo, d_hi;
+   int k;
+
+   load_row_u8(p, t, &a_lo, &a_hi);
+   load_row_u8(p + stride, t, &b_lo, &b_hi);
+   /* rows by pairs, so that even & odd rows add to their own field accumulators */
+   for (k=0; k+2<=field_rows; k+=2) {
+      load_row_u8(p + (size_t)(k+2)*stride, t, &c_lo, &c_hi);
+      load_row_u8(p + (size_t)(k+3)*stride, t, &d_lo, &d_hi);
+      ssd2_step_u8(acc, 0, a_lo, a_hi, b_lo, b_hi, c_lo, c_hi);
+      ssd2_step_u8(acc, 1, b_lo, b_hi, c_lo, c_hi, d_lo, d_hi);
+      a_lo = c_lo, a_hi = c_hi;
+      b_lo = d_lo, b_hi = d_hi;
+   }
+   if (k < field_rows) {
+      load_row_u8(p + (size_t)(k+2)*stride, t, &c_lo, &c_hi);
+      ssd2_step_u8(acc, 0, a_lo, a_hi, b_lo, b_hi, c_lo, c_hi);
+      a_lo = b_lo, a_hi = b_hi;
+      b_lo = c_lo, b_hi = c_hi;
+      k++;
+   }
+   for (; k<frame_rows; k++) {
+      acc->frame_lo = add_sq_diff_epi16(acc->frame_lo, a_lo, b_lo);
+      acc->frame_hi = add_sq_diff_epi16(acc->frame_hi, a_hi, b_hi);
+      if (k+1 < frame_rows) {
+         a_lo = b_lo, a_hi = b_hi;
+         load_row_u8(p + (size_t)(k+2)*stride, t, &b_lo, &b_hi);
+      }
+   }
+}
+
+/*! Accumulate one block of n bytes of frame_rows rows, of which field_rows have a field partner */
+static inline __attribute__((always_inline)) void ssd2_block_u8 (unsigned char *p, int stride, int n, int frame_rows, int field_rows, rows_acc_t *acc)
+{
+   int x;
+
+   for (x=0; x+16<=n; x+=16)
+      ssd2_strip_u8(p+x, stride, 16, frame_rows, field_rows, acc);
+   if (x < n)    // last n - x bytes, in the 16 bytes ending the block (a block or 16 bytes precede them)
+      ssd2_strip_u8(p+n-16, stride, n-x, frame_rows, field_rows, acc);
+}
+
+/*! Add the three sums of a block to *dd_frame, *dd_field0 & *dd_field1: frame & even field rows interleaved, then odd field rows */
+static inline void reduce_acc (rows_acc_t *acc, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1)
+{
+   __m128i f, e, fe, fo;
+
+   f = _mm_add_epi32(acc->frame_lo, acc->frame_hi);
+   e = _mm_add_epi32(acc->field_lo[0], acc->field_hi[0]);
+   fe = _mm_add_epi32(_mm_unpacklo_epi32(f, e), _mm_unpackhi_epi32(f, e));
+   fe = _mm_add_epi32(fe, _mm_srli_si128(fe, 8));
+   fo = _mm_add_epi32(acc->field_lo[1], acc->field_hi[1]);
+   fo = _mm_add_epi32(fo, _mm_srli_si128(fo, 8));
+   fo = _mm_add_epi32(fo, _mm_srli_si128(fo, 4));
+   *dd_frame += (uint32_t)_mm_cvtsi128_si32(fe);
+   *dd_field0 += (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(fe, 4));
+   *dd_field1 += (uint32_t)_mm_cvtsi128_si32(fo);
+}
+
+/*!
+ * @brief Accumulate SSDs of a row of statistics blocks against next rows & field partners with SSE2
+ * 
+ * See ssd2_rows_u8_c() for parameters.
+ */
+void ssd2_rows_u8_sse2_intrin (unsigned char *p, int stride, int width, int frame_rows, int field_rows, uint64_t *dd_frame, uint64_t *dd_field0, uint64_t *dd_field1)
+{
+   rows_acc_t acc;
+   int c, j;
+
+   if (width < 16) {
+      ssd2_rows_u8_c(p, stride, width, frame_rows, field_rows, dd_frame, dd_field0, dd_field1);
+      return;
+   }
+   for (c=0, j=0; j<width; c++, j+=BLOCK_WIDTH) {
+      acc.frame_lo = acc.frame_hi = _mm_setzero_si128();
+      acc.field_lo[0] = acc.field_hi[0] = acc.field_lo[1] = acc.field_hi[1] = _mm_setzero_si128();
+      ssd2_block_u8(p+j, stride, min(BLOCK_WIDTH, width - j), frame_rows, field_rows, &acc);
+      reduce_acc(&acc, &dd_frame[c], &dd_field0[c], &dd_field1[c]);
+   }
+}
+
+/*
+ * 16-bit sample kernels: differences are taken as |p - q| with saturating subtractions,
+ * so that full 16-bit input is handled exactly; squares are formed from the low & high
+ * halves of 16x16-bit products, and all sums are accumulated in 64-bit lanes.
+ */
+
+/* max number of blocks summed in 32-bit lanes before widening SAD (up to 4 x 0xFFFF per lane & nx16 block) */
+#define SAD_U16_BLOCKS  16384
+
+/*! |a - b| of unsigned 16-bit lanes */
+static inline __m128i absdiff_epu16 (__m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_subs_epu16(a, b), _mm_subs_epu16(b, a));
+}
+
+/*! Add unsigned 32-bit lanes of x to 64-bit lanes of acc */
+static inline __m128i add_epu32_epi64 (__m128i acc, __m128i x)
+{
+   __m128i zeros = _mm_setzero_si128();
+   acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(x, zeros));
+   return _mm_add_epi64(acc, _mm_unpackhi_epi32(x, zeros));
+}
+
+/*! Add squares of unsigned 16-bit lanes of d to 64-bit lanes of acc */
+static inline __m128i add_sq_epu16 (__m128i acc, __m128i d)
+{
+   __m128i lo = _mm_mullo_epi16(d, d);
+   __m128i hi = _mm_mulhi_epu16(d, d);
+   acc = add_epu32_epi64(acc, _mm_unpacklo_epi16(lo, hi));
+   return add_epu32_epi64(acc, _mm_unpackhi_epi16(lo, hi));
+}
+
+/*! Sum of 64-bit lanes */
+static inline uint64_t hsum_epi64 (__m128i x)
+{
+   uint64_t result[2];
+   _mm_storeu_si128((__m128i *)result, x);
+   return result[0] + result[1];
+}
+
+/*! SAD of n blocks of 8 (nx8) or 16 (nx16) samples, 32-bit lanes widened every SAD_U16_BLOCKS blocks */
+static inline uint64_t sad_u16_sse2 (uint16_t *p, uint16_t *q, int pitch, int n, int block)
+{
+   __m128i s, zeros = _mm_setzero_si128();
+   __m128i sad = _mm_setzero_si128();
+   int i, k, m;
+
+   for (i=0; i<n; ) {
+      s = _mm_setzero_si128();
+      for (m=min(n, i+SAD_U16_BLOCKS); i<m; i++)
+         for (k=0; k<block; k+=8) {
+            __m128i d = absdiff_epu16(_mm_loadu_si128((__m128i *)(p+i*pitch+k)), _mm_loadu_si128((__m128i *)(q+i*pitch+k)));
+            s = _mm_add_epi32(s, _mm_add_epi32(_mm_unpacklo_epi16(d, zeros), _mm_unpackhi_epi16(d, zeros)));
+         }
+      sad = add_epu32_epi64(sad, s);
+   }
+   return hsum_epi64(sad);
+}
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx8 window of 16-bit samples with SSE2
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    8 samples length
+ * @param n        n = len(array)/pitch
+ * @return uint64_t 
+ */
+uint64_t sad_nx8_u16_sse2_intrin (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   return sad_u16_sse2(p, q, pitch, n, 8);
+}
+
+/*!
+ * @brief Calcalute sum of absolute difference between nx16 window of 16-bit samples with SSE2
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    16 samples length
+ * @param n        n = len(array)/pitch
+ * @return uint64_t 
+ */
+uint64_t sad_nx16_u16_sse2_intrin (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   return sad_u16_sse2(p, q, pitch, n, 16);
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx8 window of 16-bit samples with SSE2
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    8 samples length
+ * @param n        n = len(array)/pitch
+ * @return uint64_t 
+ */
+uint64_t ssd_nx8_u16_sse2_intrin (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   __m128i d;
+   int i;
+
+   __m128i ssd = _mm_setzero_si128();
+   for (i=0; i<n; i++) {
+      d = absdiff_epu16(_mm_loadu_si128((__m128i *)(p+i*pitch)), _mm_loadu_si128((__m128i *)(q+i*pitch)));
+      ssd = add_sq_epu16(ssd, d);
+   }
+   return hsum_epi64(ssd);
+}
+
+/*!
+ * @brief Calcalute sum of squared difference between nx16 window of 16-bit samples with SSE2
+ * 
+ * @param p        1st array of data
+ * @param q        2nd array of data
+ * @param pitch    16 samples length
+ * @param n        n = len(array)/pitch
+ * @return uint64_t 
+ */
+uint64_t ssd_nx16_u16_sse2_intrin (uint16_t *p, uint16_t *q, int pitch, int n)
+{
+   __m128i d, d1;
+   int i;
+
+   __m128i ssd = _mm_setzero_si128();
+   for (i=0; i<n; i++) {
+      d = absdiff_epu16(_mm_loadu_si128((__m128i *)(p+i*pitch)), _mm_loadu_si128((__m128i *)(q+i*pitch)));
+      d1 = absdiff_epu16(_mm_loadu_si128((__m128i *)(p+i*pitch+8)), _mm_loadu_si128((__m128i *)(q+i*pitch+8)));
+      ssd = add_sq_epu16(add_sq_epu16(ssd, d), d1);
+   }
+   return hsum_epi64(ssd);
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one nx16 window of 16-bit samples against two others with SSE2
+ * 
+ * @param p        reference array of data
+ * @param q        2nd array of data
+ * @param r        3rd array of data
+ * @param pitch    16 samples length
+ * @param n        n = len(array)/pitch
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_nx16_u16_sse2_intrin (uint16_t *p, uint16_t *q, uint16_t *r, int pitch, int n, uint64_t *ssd_pq, uint64_t *ssd_pr)
+{
+   __m128i vp, vp1;
+   int i;
+
+   __m128i pq = _mm_setzero_si128();
+   __m128i pr = _mm_setzero_si128();
+   for (i=0; i<n; i++) {
+      vp = _mm_loadu_si128((__m128i *)(p+i*pitch));
+      vp1 = _mm_loadu_si128((__m128i *)(p+i*pitch+8));
+      pq = add_sq_epu16(pq, absdiff_epu16(vp, _mm_loadu_si128((__m128i *)(q+i*pitch))));
+      pq = add_sq_epu16(pq, absdiff_epu16(vp1, _mm_loadu_si128((__m128i *)(q+i*pitch+8))));
+      pr = add_sq_epu16(pr, absdiff_epu16(vp, _mm_loadu_si128((__m128i *)(r+i*pitch))));
+      pr = add_sq_epu16(pr, absdiff_epu16(vp1, _mm_loadu_si128((__m128i *)(r+i*pitch+8))));
+   }
+   *ssd_pq = hsum_epi64(pq);
+   *ssd_pr = hsum_epi64(pr);
+}
+
+/*!
+ * @brief Calcalute sums of squared difference of one row of 16-bit samples against two others with SSE2
+ * 
+ * The last n % 16 samples are compared in the 16-sample block ending the row, masked
+ * as in ssd2_row_u8_sse2_intrin().
+ * 
+ * @param p        reference row
+ * @param q        2nd row
+ * @param r        3rd row
+ * @param n        row length [in samples], any value
+ * @param ssd_pq   SSD between p and q
+ * @param ssd_pr   SSD between p and r
+ */
+void ssd2_row_u16_sse2_intrin (uint16_t *p, uint16_t *q, uint16_t *r, int n, uint64_t *ssd_pq, uint64_t *ssd_pr)
+{
+   __m128i m, m1, vp, vp1;
+   __m128i pq = _mm_setzero_si128();
+   __m128i pr = _mm_setzero_si128();
+   int t = n % 16;
+
+   if (n < 16) {
+      ssd2_row_u16_c(p, q, r, n, ssd_pq, ssd_pr);
+      return;
+   }
+   ssd2_nx16_u16_sse2_intrin(p, q, r, 16, n/16, ssd_pq, ssd_pr);
+   if (t) {
+      p += n - 16, q += n - 16, r += n - 16;
+      m = _mm_loadu_si128((__m128i *)(tail_mask_u16 + t));
+      m1 = _mm_loadu_si128((__m128i *)(tail_mask_u16 + t + 8));
+      vp = _mm_and_si128(m, _mm_loadu_si128((__m128i *)p));
+      vp1 = _mm_and_si128(m1, _mm_loadu_si128((__m128i *)(p+8)));
+      pq = add_sq_epu16(pq, absdiff_epu16(vp, _mm_and_si128(m, _mm_loadu_si128((__m128i *)q))));
+      pq = add_sq_epu16(pq, absdiff_epu16(vp1, _mm_and_si128(m1, _mm_loadu_si128((__m128i *)(q+8)))));
+      pr = add_sq_epu16(pr, absdiff_epu16(vp, _mm_and_si128(m, _mm_loadu_si128((__m128i *)r))));
+      pr = add_sq_epu16(pr, absdiff_epu16(vp1, _mm_and_si128(m1, _mm_loadu_si128((__m128i *)(r+8)))));
+      *ssd_pq += hsum_epi64(pq);
+      *ssd_pr += hsum_epi64(pr);
+   }
+}
+
+/*!
+ * @brief Downscale two rows by averaging 2x2 pixels with SSE2
+ * 
+ * @param a        1st row (2n pixels)
+ * @param b        2nd row (2n pixels)
+ * @param out      output row (n pixels)
+ * @param n        number of output pixels
+ */
+void avg_2x2_u8_sse2_intrin (unsigned char *a, unsigned char *b, unsigned char *out, int n)
+{
+   __m128i v0, v1;
+   int x;
+
+   __m128i mask = _mm_set1_epi16(0x00FF);
+   for (x=0; x+16<=n; x+=16) {
+      /* vertical average, then average of even & odd pixels in 16-bit lanes */
+      v0 = _mm_avg_epu8(_mm_loadu_si128((__m128i *)(a+2*x)), _mm_loadu_si128((__m128i *)(b+2*x)));
+      v1 = _mm_avg_epu8(_mm_loadu_si128((__m128i *)(a+2*x+16)), _mm_loadu_si128((__m128i *)(b+2*x+16)));
+      v0 = _mm_avg_epu16(_mm_and_si128(v0, mask), _mm_srli_epi16(v0, 8));
+      v1 = _mm_avg_epu16(_mm_and_si128(v1, mask), _mm_srli_epi16(v1, 8));
+      _mm_storeu_si128((__m128i *)(out+x), _mm_packus_epi16(v0, v1));
+   }
+   avg_2x2_u8_c(a+2*x, b+2*x, out+x, n-x);
+}
@@ -23,8 +23,6 @@
 #include <sys/types.h>
 #include <time.h>
 #include <stdint.h>
-#define _unlink unlink
-#define _rmdir rmdir
 #define DIRSEP '/'
 #include <strings.h> // for strcasecmps
 #endif
@@ -35,10 +33,12 @@
 #include <string.h>
 #include <math.h>
 #include <assert.h>
+#include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
 
 #include "getopt.h"
 #include "pattern_detector.h"
-#include "timer.h"
 
 /*! Extract integer */
 static int get_int (char *s, int *x, int x_min, int x_max)
@@ -81,6 +81,36 @@ static int get_framerate (char *s, fps_t *fps)
   return (fps->num <= 0 || fps->denom <= 0 || fps_to_float(*fps) < 0.1f || fps_to_float(*fps) > 300.0)? 1: 0;
 }
 
+/*! Extract confidence bound */
+static int get_confidence (char *s, double *x)
+{
+  /* sanity checks */
+  assert(s != NULL);
+  assert(x != NULL);
+
+  /* read number */
+  *x = strtod(s, &s);
+
+  /* check range */
+  return (*x <= 0.5 || *x >= 1.0)? 1: 0;
+}
+
+/*! Extract sampling parameters: number of segments & frames per segment */
+static int get_sample (char *s, int *segments, int *length)
+{
+  /* sanity checks */
+  assert(s != NULL);
+  assert(segments != NULL);
+  assert(length != NULL);
+
+  /* read "K:M" */
+  *segments = (int)strtol(s, &s, 10);
+  *length = (*s == ':' || *s == 'x')? (int)strtol(s + 1, &s, 10): 0;
+
+  /* check range */
+  return (*segments < 1 || *segments > MAX_SAMPLE_SEGMENTS || *length < 1 || *s != 0)? 1: 0;
+}
+
 /*! Extract resolution */
 static int get_resolution (char *s, res_t *res)
 {
@@ -95,12 +125,23 @@ static int get_resolution (char *s, res_t *res)
   res->width = (int)strtol(s, &s, 10);
   printf("Width: %d   ", res->width);
   if (strlen(s) > 1) res->height = (int)strtol(s + 1, &s, 10);
-  printf("Height: %d", res->height);
+  printf("Height: %d\n", res->height);
 
   /* check if resolution is valid */
   return (res->width < 0 || res->height < 0 || res->width > MAX_WIDTH || res->height > MAX_HEIGHT || res->height & 1)? 1: 0;
 }
 
+/*! Kernel ASM type */
+static int get_asm (char *arg, int *asm_type)
+{
+  /* sanity checks */
+  assert(arg != NULL);
+  assert(asm_type != NULL);
+
+  /* check string values: */
+  return asm_type_by_name(arg, asm_type);
+}
+
 /*! Chroma subsamping format & bitdepth parameters */
 static int get_format(char *arg, int *format, int *bitdepth)
 {
@@ -120,6 +161,14 @@ static int get_format(char *arg, int *format, int *bitdepth)
   else if (!strcasecmp(arg, "yuv420p10le")) {*format = FORMAT_YUV420; *bitdepth = 10;}
   else if (!strcasecmp(arg, "yuv422p10le")) {*format = FORMAT_YUV422; *bitdepth = 10;}
   else if (!strcasecmp(arg, "yuv444p10le")) {*format = FORMAT_YUV444; *bitdepth = 10;}
+  else if (!strcasecmp(arg, "yuv420p12le")) {*format = FORMAT_YUV420; *bitdepth = 12;}
+  else if (!strcasecmp(arg, "yuv422p12le")) {*format = FORMAT_YUV422; *bitdepth = 12;}
+  else if (!strcasecmp(arg, "yuv444p12le")) {*format = FORMAT_YUV444; *bitdepth = 12;}
+  else if (!strcasecmp(arg, "yuv420p16le")) {*format = FORMAT_YUV420; *bitdepth = 16;}
+  else if (!strcasecmp(arg, "yuv422p16le")) {*format = FORMAT_YUV422; *bitdepth = 16;}
+  else if (!strcasecmp(arg, "yuv444p16le")) {*format = FORMAT_YUV444; *bitdepth = 16;}
+  else if (!strcasecmp(arg, "gray") || !strcasecmp(arg, "y800")) {*format = FORMAT_YUV400; *bitdepth = 8;}
+  else if (!strcasecmp(arg, "gray10le")) {*format = FORMAT_YUV400; *bitdepth = 10;}
   else return 1;
 
   /* success: */
@@ -167,11 +216,27 @@ static void help (char *prog)
     "\n"
     "Options:\n"
     "\n"
-    "  -i, --input       <string>             Name of uncompressed video file to be analyzed (.yuv or .y4m)\n"
-    "  -r, --resolution  <int x int>          Video resolution (width x height, in pixels)\n"
-    "  -f, --framerate   <float or fraction>  Framerate (in fps)\n"
-    "  -c, --csp         <string>             Chroma sub-sampling format (e.g. \"yuv420p\", \"yuv422p\", etc)\n"
-    "  -y  --temp_dir <directory>             Directory to use for intermediate files\n"
+    "  -i, --input       <string>             Name of uncompressed video file to be analyzed (.yuv or .y4m, \"-\" for stdin)\n"
+    "  -r, --resolution  <int x int>          Video resolution (width x height, in pixels; taken from header for .y4m)\n"
+    "  -f, --framerate   <float or fraction>  Framerate (in fps; taken from header for .y4m)\n"
+    "  -c, --csp         <string>             Chroma sub-sampling format (e.g. \"yuv420p\", \"yuv422p\", etc; taken from header for .y4m)\n"
+    "  -s, --trust_y4m                        Report scan type from .y4m interlacing tag without analysis, if tagged\n"
+    "  -e, --early_exit  <float>              Stop reading once scan type is known with given confidence (e.g. 0.999)\n"
+    "  -p, --sample      <int:int>            Analyze only K evenly spaced segments of M consecutive frames (K:M)\n"
+    "  -C, --cascade                          Analyze decimated rows & columns first, full resolution only for ambiguous frames\n"
+    "  -A, --active_area <int>                Analyze only the area inside black bars, detected every N frames\n"
+    "  -u, --chroma                           Analyze chroma planes too & report their gamma (not with --luma_only or --batch)\n"
+    "  -B, --batch       <string>             Analyze all files of a list (lines: file [WxH] [csp]), --threads files at a time\n"
+    "  -o, --stats_log   <string>             Write per-frame statistics to binary columnar log (see stats_log_csv)\n"
+    "  -k, --block_stats                      Add gamma of each block to binary log\n"
+    "  -y  --temp_dir <directory>             Directory of per-frame text log written in verbose mode\n"
+    "  -t, --threads     <int>                Number of frame analysis threads (0 = analyze on main thread)\n"
+    "  -b, --band_threads <int>               Number of extra threads analyzing row bands of each frame (0 = off)\n"
+    "  -m, --mmap                             Read frames in place from memory-mapped input file\n"
+    "  -l, --luma_only                        Read only luma plane of each frame, skipping chroma\n"
+    "  -a, --asm         <string>             Kernel instruction set: \"c\", \"sse2\", \"avx2\", \"avx512\", \"avx512vnni\" or \"auto\" (default)\n"
+    "                                         (can also be set by " ASM_ENV_VAR " environment variable)\n"
+    "  -S, --stats                            Print per-stage timings, frame latency percentiles & throughput\n"
     "  -v, --verbose                          Print internal statistics & debug information\n"
     "  -h, --help                             Display help\n"
     "\n",
@@ -180,10 +245,10 @@ static void help (char *prog)
 }
 
 /*! Read program command-line  */
-static void read_command_line(int argc, char *argv[], char **input, res_t *resolution, fps_t *framerate, int *format, char **temp_dir, int *bitdepth, int *verbose)
+static void read_command_line(int argc, char *argv[], char **input, res_t *resolution, fps_t *framerate, int *format, char **temp_dir, int *bitdepth, int *threads, int *band_threads, int *reader_mode, int *asm_type, int *trust_y4m, double *early_exit, int *sample_segments, int *sample_length, int *cascade, int *crop_interval, int *chroma, char **batch, char **stats_log, int *block_stats, int *print_stats, int *verbose)
 {
   /* command-line parsing structure */
-  static char optstring[] = "i:r:f:c:y:vh";
+  static char optstring[] = "i:r:f:c:y:t:b:mla:se:p:CA:uB:o:kSvh";
   static struct option long_options[] = 
   {
     {"input",       required_argument, 0, 'i'},
@@ -191,6 +256,21 @@ static void read_command_line(int argc, char *argv[], char **input, res_t *resol
     {"framerate",   required_argument, 0, 'f'},
     {"csp",         required_argument, 0, 'c'},
     {"temp_dir",    required_argument, 0, 'y'},
+    {"threads",     required_argument, 0, 't'},
+    {"band_threads", required_argument, 0, 'b'},
+    {"mmap",        no_argument,       0, 'm'},
+    {"luma_only",   no_argument,       0, 'l'},
+    {"asm",         required_argument, 0, 'a'},
+    {"trust_y4m",   no_argument,       0, 's'},
+    {"early_exit",  required_argument, 0, 'e'},
+    {"sample",      required_argument, 0, 'p'},
+    {"cascade",     no_argument,       0, 'C'},
+    {"active_area", required_argument, 0, 'A'},
+    {"chroma",      no_argument,       0, 'u'},
+    {"batch",       required_argument, 0, 'B'},
+    {"stats_log",   required_argument, 0, 'o'},
+    {"block_stats", no_argument,       0, 'k'},
+    {"stats",       no_argument,       0, 'S'},
     {"verbose",     no_argument,       0, 'v'},
     {"help",        no_argument,       0, 'h'},
     {0,             0,                 0, 0}
@@ -210,6 +290,21 @@ static void read_command_line(int argc, char *argv[], char **input, res_t *resol
       case 'f': if (get_framerate (optarg, framerate))                    goto valerr; break;
       case 'c': if (get_format (optarg, format, bitdepth))                goto valerr; break;
       case 'y': if ((*temp_dir = optarg) == NULL)                         goto valerr; break;
+      case 't': if (get_int (optarg, threads, 0, MAX_THREADS))            goto valerr; break;
+      case 'b': if (get_int (optarg, band_threads, 0, MAX_THREADS))       goto valerr; break;
+      case 'm': *reader_mode = READER_MMAP;                               break;
+      case 'l': *reader_mode = READER_LUMA;                               break;
+      case 'a': if (get_asm (optarg, asm_type))                           goto valerr; break;
+      case 's': *trust_y4m = 1;                                           break;
+      case 'e': if (get_confidence (optarg, early_exit))                  goto valerr; break;
+      case 'p': if (get_sample (optarg, sample_segments, sample_length))  goto valerr; break;
+      case 'C': *cascade = 1;                                             break;
+      case 'A': if (get_int (optarg, crop_interval, 1, INT_MAX))          goto valerr; break;
+      case 'u': *chroma = 1;                                              break;
+      case 'B': if ((*batch = optarg) == NULL)                            goto valerr; break;
+      case 'o': if ((*stats_log = optarg) == NULL)                        goto valerr; break;
+      case 'k': *block_stats = 1;                                         break;
+      case 'S': *print_stats = 1;                                               break;
       case 'v': *verbose = 1;                                             break;
       case 'h': default: help(argv[0]);
        /* errors */
@@ -228,125 +323,470 @@ static void read_command_line(int argc, char *argv[], char **input, res_t *resol
   }
 
   /* check if input file is specified */
-  if (*input == NULL) error (1, "Input video file is not specified.\n");
+  if (*input == NULL && *batch == NULL) error (1, "Input video file is not specified.\n");
+}
 
-  /* check presence of mandatory parameters: */
-  if (!resolution->height || !resolution->width) error (1, "Video resolution must be specified.\n");
-  if (!framerate->num || !framerate->denom) error (1, "Video framerate must be specified.\n");
+/******************************************************* 
+ * 
+ *  Frame processing stages (used directly, or as pipeline callbacks): 
+ *
+ *  read_frame()
+ *  analyze_frame()
+ *  commit_frame()
+ * 
+ ****/
+
+/*! State shared by frame processing stages */
+typedef struct {
+  frame_reader_t *reader;
+  pd_context_t *pd;           //!< detector
+  int stride;                 //!< distance between luma rows [in bytes]
+  int chroma_stride;          //!< distance between chroma rows [in bytes], 0 if chroma is not analyzed
+  int luma_size;              //!< offset of U plane in frame [in bytes]
+  int chroma_size;            //!< size of each chroma plane [in bytes]
+  FILE *f_delta_log;          //!< text log, NULL if off
+  stats_log_t *stats_log;     //!< binary log, NULL if off
+  profile_t *profile;         //!< stage instrumentation, NULL if off
+  int early_exit;             //!< !0 if reading stops once scan type is decided
+  int exit_frame;             //!< number of frames committed when scan type was decided, 0 if not yet
+  int stop;                   //!< !0 once no more frames should be read (accessed atomically)
+  int sample_segments;        //!< number of sampled segments, 0 to read all frames
+  int sample_length;          //!< number of frames per segment
+  long long total_frames;     //!< number of frames in input (when sampling)
+  int frames_read;            //!< number of frames read (reader stage only)
+  int verbose;
+} frame_ctx_t;
+
+/*! First frame of sampled segment k: segments are evenly spaced from start to end of input */
+static long long sample_start (frame_ctx_t *ctx, int k)
+{
+  long long span = ctx->total_frames - ctx->sample_length;
+  return (ctx->sample_segments > 1)? k * span / (ctx->sample_segments - 1): span / 2;
 }
 
-/*! 
- *  \brief Compute size of an image/frame stored using a given format 
- */
-static int frame_size (res_t *res, int format, int bitdepth)
+/*! Read next frame into buffer & set the area it is analyzed on, return frame data or NULL at end of input */
+static unsigned char *read_frame (void *arg, unsigned char *buffer, frame_stats_t *stats)
 {
-  int size = 0;
+  frame_ctx_t *ctx = (frame_ctx_t *) arg;
+  unsigned char *data;
+  int64_t t0 = 0;
+  int k;
+
+  if (__atomic_load_n(&ctx->stop, __ATOMIC_ACQUIRE))
+    return NULL;
+  if (ctx->profile != NULL)
+    t0 = profile_now(ctx->profile);
+
+  /* sampling: seek to next segment when current one is complete */
+  if (ctx->sample_segments > 0 && ctx->frames_read % ctx->sample_length == 0) {
+    k = ctx->frames_read / ctx->sample_length;
+    if (k >= ctx->sample_segments || reader_seek(ctx->reader, sample_start(ctx, k)))
+      return NULL;
+  }
+  data = reader_read (ctx->reader, buffer);
+  if (ctx->profile != NULL && data != NULL) {
+    ctx->profile->read_start[ctx->frames_read % PROFILE_RING] = t0;
+    profile_add(ctx->profile, STAGE_READ, profile_now(ctx->profile) - t0);
+  }
 
-  /* sanity checks */
-  assert(res != NULL);
+  /* active area is detected in frame order, on frame indices counted from the start of each segment */
+  if (data != NULL && pd_detect_area (ctx->pd, stats, data, ctx->stride, (ctx->sample_segments > 0)? ctx->frames_read % ctx->sample_length: ctx->frames_read))
+    error(1, "Out of memory.\n");
+  ctx->frames_read ++;
+  return data;
+}
 
-  /* compute image size based on format: */
-  switch (format)  {
-    case FORMAT_YUV420:   size = res->height * res->width * 3/2;  break;
-    case FORMAT_YUV422:   size = res->height * res->width * 2;    break;
-    case FORMAT_YUV444:   size = res->height * res->width * 3;    break;
+/*! Compute frame statistics (thread-safe) */
+static void analyze_frame (void *arg, unsigned char *frame, frame_stats_t *stats)
+{
+  frame_ctx_t *ctx = (frame_ctx_t *) arg;
+  const unsigned char *planes[3] = {frame, NULL, NULL};
+  int strides[3] = {ctx->stride, ctx->chroma_stride, ctx->chroma_stride};
+  int64_t t0 = 0;
+
+  if (ctx->profile != NULL)
+    t0 = profile_now(ctx->profile);
+  if (ctx->chroma_stride > 0) {
+    planes[1] = frame + ctx->luma_size;
+    planes[2] = planes[1] + ctx->chroma_size;
+  }
+  if (pd_analyze_planes (ctx->pd, stats, planes, strides))
+    error(1, "Out of memory.\n");
+  if (ctx->profile != NULL)
+    profile_add(ctx->profile, STAGE_ANALYZE, profile_now(ctx->profile) - t0);
+}
+
+/*! Log frame statistics, called in frame order */
+static void commit_frame (void *arg, int index, unsigned char *frame, frame_stats_t *stats)
+{
+  frame_ctx_t *ctx = (frame_ctx_t *) arg;
+  pd_frame_result_t fr;
+  int64_t t0 = 0, t1 = 0, t2;
+  int decided;
+
+  reader_release (ctx->reader, frame);
+  if (ctx->profile != NULL)
+    t0 = profile_now(ctx->profile);
+  if (ctx->sample_segments > 0 && index > 0 && index % ctx->sample_length == 0)
+    pd_restart (ctx->pd);   // segments are not contiguous
+  decided = pd_commit_frame (ctx->pd, stats, &fr);
+  if (ctx->profile != NULL)
+    t1 = profile_now(ctx->profile);
+  if (ctx->stats_log != NULL)
+    stats_log_push (ctx->stats_log, (ctx->sample_segments > 0)? (int)(sample_start(ctx, index / ctx->sample_length) + index % ctx->sample_length): index,
+                    stats, &fr);
+  if (ctx->f_delta_log != NULL) {
+    fprintf (ctx->f_delta_log, "%8.5f,%8.5f,%8.5f,%8.5f,%d,%c,%d,%d,%c", fr.delta_frame, fr.delta_even, fr.delta_odd, fr.gamma,
+             fr.combed_blocks, fr.match, fr.drop, fr.phase, (fr.order == SCAN_INTERLACE_TFF)? 't': (fr.order == SCAN_INTERLACE_BFF)? 'b': '-');
+    if (ctx->chroma_stride > 0)
+      fprintf (ctx->f_delta_log, ",%8.5f,%8.5f", fr.gamma_u, fr.gamma_v);
+    fprintf (ctx->f_delta_log, "\n");
+  }
+  if (ctx->profile != NULL) {
+    t2 = profile_now(ctx->profile);
+    profile_add(ctx->profile, STAGE_CLASSIFY, t1 - t0);
+    if (ctx->stats_log != NULL || ctx->f_delta_log != NULL)
+      profile_add(ctx->profile, STAGE_LOG, t2 - t1);
+    profile_add(ctx->profile, STAGE_FRAME, t2 - ctx->profile->read_start[index % PROFILE_RING]);
   }
 
-  /* adjust based on pixel depth: */
-  if (bitdepth > 8)
-    size *= 2; 
+  /* stop reading once scan type is known; frames already read are still committed */
+  if (ctx->early_exit && decided && !ctx->exit_frame) {
+    ctx->exit_frame = index + 1;
+    __atomic_store_n(&ctx->stop, 1, __ATOMIC_RELEASE);
+  }
 
-  /* return 0 if error, frame size otherwize */
-  return size;
+  /* print progress: */
+  if (ctx->verbose && index > 0 && index % 10 == 0)
+    printf(".");
 }
 
+/*! Messages for open_input() error codes */
+static const char *input_errors[] = {
+  NULL,
+  "cannot open file or invalid Y4M header",
+  "video resolution must be specified",
+  "invalid video parameters",
+  "cannot start reading"
+};
+
 /*!
- * @brief Given a frame, calculate the average pixel difference between odd fields (delta_odd) and even fields (delta_even)
+ *  \brief Open input & prepare reader for frames of given format
+ *
+ *  Parameters found in a Y4M stream header override the given ones. Inputs that
+ *  cannot be read with the requested reader are read with READER_STDIO or
+ *  READER_STREAM instead (reader->mode reports the mode in use).
+ *
+ *  \param[out]    reader      - reader
+ *  \param[in]     input       - file name, or "-" for standard input
+ *  \param[in]     reader_mode - requested reader mode
+ *  \param[in,out] res         - resolution
+ *  \param[in,out] fps         - framerate
+ *  \param[in,out] format      - chroma format
+ *  \param[in,out] bitdepth    - sample bitdepth
+ *
+ *  \returns    0 if success, or index of error message in input_errors[]
+ */
+static int open_input (frame_reader_t *reader, char *input, int reader_mode, res_t *res, fps_t *fps, int *format, int *bitdepth)
+{
+  int size;
+
+  if (reader_open(reader, input, reader_mode) && (reader_mode == READER_STDIO || reader_open(reader, input, READER_STDIO)))
+    return 1;
+  if (reader->y4m) {
+    *res = reader->y4m_info.res;
+    *fps = reader->y4m_info.fps;
+    *format = reader->y4m_info.format;
+    *bitdepth = reader->y4m_info.bitdepth;
+  }
+  if (!res->height || !res->width) {
+    reader_close(reader);
+    return 2;
+  }
+  if ((size = pd_frame_size(res->width, res->height, *format, *bitdepth)) <= 0) {
+    reader_close(reader);
+    return 3;
+  }
+  if (reader_set_frame_size(reader, size, res->width * res->height * ((*bitdepth > 8)? 2: 1))) {
+    reader_close(reader);
+    return 4;
+  }
+  return 0;
+}
+
+/******************************************************* 
  * 
- * @param[in] frame 
- * @param[in] res 
- * @param[out] delta_even  
- * @param[out] delta_odd 
+ *  Batch mode: 
+ *
+ *  read_batch_list()
+ *  batch_file_task()
+ *  run_batch()
+ * 
+ ****/
+
+/*! Batch input: file of the list, its video parameters & result */
+typedef struct {
+  char *input;
+  res_t res;
+  fps_t fps;
+  int format;
+  int bitdepth;
+  int status;                 //!< 0 if analyzed, index of input_errors[] message otherwise
+  int frames;                 //!< number of frames analyzed
+  pd_result_t result;
+} batch_entry_t;
+
+/*! Analysis state reused across files: detector & frame buffer */
+typedef struct batch_state {
+  pd_params_t params;         //!< parameters detector was created with
+  pd_context_t *pd;
+  pd_frame_t *frame;
+  unsigned char *buffer;
+  int buffer_size;
+  struct batch_state *next;   //!< next state in free list
+} batch_state_t;
+
+/*! Batch job shared by file tasks */
+typedef struct {
+  batch_entry_t *entries;
+  int reader_mode;
+  int asm_type;
+  double early_exit;
+  int sample_segments, sample_length;
+  int cascade;
+  int crop_interval;
+  pthread_mutex_t lock;       //!< protects free list
+  batch_state_t *free_states; //!< states not in use by a task
+} batch_job_t;
+
+/*!
+ *  \brief Read list of files to analyze
+ *
+ *  Each line holds a file name, optionally followed by its resolution (WxH) and chroma
+ *  format; missing parameters are taken from the command line (or from Y4M headers).
+ *  Empty lines & lines starting with '#' are skipped.
+ *
+ *  \returns    number of entries, or -1 if list cannot be read or has invalid parameters
  */
-void calculate_field_delta(unsigned char *frame, res_t *res, float *delta_even, float *delta_odd)
+static int read_batch_list (char *list, res_t *res, int format, int bitdepth, batch_entry_t **entries)
 {
-  int i, j, d_even =0, d_odd=0, dd_even =0, dd_odd=0;
-  timestamp_t start_time, stop_time;   /* runtimes for each pass */
-  double exec_time_c=0.0, exec_time_avx=0.0;
-  int pitch = 16;
-  int n = res->width/pitch;
-  int dd_even_avx=0, dd_odd_avx=0;
-
-  get_time(&start_time);
-  for (i=0; i<(res->height/2-1); i++){
-    for(j=0; j<res->width; j++) {
-        d_even = frame[2*i*res->width + j]-frame[2*(i+1)*res->width + j];
-        dd_even += d_even * d_even;
-
-        d_odd = frame[(2*i+1)*res->width + j]-frame[(2*i+3)*res->width + j];   
-        dd_odd += d_odd * d_odd;  
-      }                   
-  }
-  get_time (&stop_time);
-  exec_time_c = elapsed_time (&start_time, &stop_time);
-  printf("\n");
-  printf("dd_even_norm: %-16d      dd_odd_norm:%-13d     norm_t: %f\n", dd_even, dd_odd, exec_time_c);
+  FILE *f;
+  char line[STRLEN], *name, *arg;
+  batch_entry_t *e, *grown;
+  int n = 0, capacity = 0, lineno = 0, result = -1;
+
+  *entries = NULL;
+  if ((f = fopen(list, "r")) == NULL)
+    return -1;
+  while (fgets(line, STRLEN, f) != NULL) {
+    lineno ++;
+    if ((name = strtok(line, " \t\r\n")) == NULL || name[0] == '#')
+      continue;
+    if (n == capacity) {
+      capacity = max(64, 2 * capacity);
+      if ((grown = (batch_entry_t *) realloc(*entries, capacity * sizeof(batch_entry_t))) == NULL) goto done;
+      *entries = grown;
+    }
+    e = &(*entries)[n];
+    memset(e, 0, sizeof(batch_entry_t));
+    e->res = *res;
+    e->format = format;
+    e->bitdepth = bitdepth;
+    if ((e->input = (char *) malloc(strlen(name) + 1)) == NULL) goto done;
+    strcpy(e->input, name);
+    n ++;
+
+    /* per-file parameters: */
+    while ((arg = strtok(NULL, " \t\r\n")) != NULL) {
+      if (strchr(arg, 'x') && isdigit((unsigned char)arg[0])) {
+        if (sscanf(arg, "%dx%d", &e->res.width, &e->res.height) != 2 || e->res.width <= 0 || e->res.height <= 0) break;
+      } else if (get_format(arg, &e->format, &e->bitdepth)) {
+        break;
+      }
+    }
+    if (arg != NULL) {
+      error(0, "%s:%d: invalid parameter '%s'\n", list, lineno, arg);
+      goto done;
+    }
+  }
+  result = n;
+
+done:
+  fclose(f);
+  if (result < 0) {
+    while (n > 0) free((*entries)[--n].input);
+    free(*entries);
+    *entries = NULL;
+  }
+  return result;
+}
+
+/*! Take a free state, preferably one with a detector for the same parameters, or create one */
+static batch_state_t *take_batch_state (batch_job_t *job, pd_params_t *params)
+{
+  batch_state_t **p, *st;
 
-  get_time(&start_time);
-  for (i=0; i<(res->height/2-1); i++){
-    dd_even_avx += ssd_nx16_u8_avx2_intrin (&frame[2*i*res->width], &frame[2*(i+1)*res->width], pitch, n);
-    dd_odd_avx += ssd_nx16_u8_avx2_intrin (&frame[(2*i+1)*res->width], &frame[(2*i+3)*res->width], pitch, n);
+  pthread_mutex_lock(&job->lock);
+  for (p = &job->free_states; *p != NULL; p = &(*p)->next)
+    if ((*p)->params.width == params->width && (*p)->params.height == params->height && (*p)->params.bitdepth == params->bitdepth)
+      break;
+  if (*p == NULL) p = &job->free_states;
+  if ((st = *p) != NULL)
+    *p = st->next;
+  pthread_mutex_unlock(&job->lock);
+
+  if (st == NULL && (st = (batch_state_t *) calloc(1, sizeof(batch_state_t))) != NULL && (st->frame = pd_frame_create()) == NULL) {
+    free(st);
+    st = NULL;
   }
-  get_time (&stop_time);
-  exec_time_avx = elapsed_time (&start_time, &stop_time);
-  printf("dd_even_avx2: %-16d      dd_odd_avx2:%-16d  avx2_t: %f\n", dd_even_avx, dd_odd_avx, exec_time_avx);
+  return st;
+}
 
-  *delta_even = (float)dd_even / ((res->height/2 -1)*res->width);
-  *delta_odd = (float)dd_odd / ((res->height/2 -1)*res->width);
+/*! Return state to free list */
+static void give_batch_state (batch_job_t *job, batch_state_t *st)
+{
+  pthread_mutex_lock(&job->lock);
+  st->next = job->free_states;
+  job->free_states = st;
+  pthread_mutex_unlock(&job->lock);
 }
 
-/*!
- * @brief Given a frame, calculate the average vertical pixel value change in frame (delta)
- * 
- * @param[in] frame 
- * @param[in] res 
- * @param[out] delta 
- */
-void calculate_frame_delta(unsigned char *frame, res_t *res, float *delta)
+/*! Thread pool task: analyze one file of the list */
+static void batch_file_task (void *arg, int i)
 {
-  int i, j, d=0, dd=0;
-  timestamp_t start_time, stop_time;   /* runtimes for each pass */
-  double exec_time_c=0.0, exec_time_avx=0.0;
-  int pitch = 16;
-  int n = res->width/pitch;
-  int dd_avx=0;
-
-  get_time(&start_time);
-  for (i=0; i<(res->height-1); i++){
-    for(j=0; j<res->width; j++) {
-      d = frame[i*res->width + j]-frame[(i+1)*res->width + j];
-      dd += d * d;     
-    }            
-  }
-  get_time (&stop_time);
-  exec_time_c = elapsed_time (&start_time, &stop_time);
-  printf("dd_frame_norm: %-47d    norm_t: %f\n", dd, exec_time_c);
-
-  get_time(&start_time);
-  for (i=0; i<(res->height-1); i++){
-    dd_avx += ssd_nx16_u8_avx2_intrin (&frame[i*res->width], &frame[(i+1)*res->width], pitch, n);
-  }
-  get_time (&stop_time);
-  exec_time_avx = elapsed_time (&start_time, &stop_time);
-  printf("dd_frame_avx2: %-47d    avx2_t: %f\n", dd_avx, exec_time_avx);
-
-  *delta = (float)dd / ((res->height-1)*res->width);
+  batch_job_t *job = (batch_job_t *) arg;
+  batch_entry_t *e = &job->entries[i];
+  batch_state_t *st;
+  frame_reader_t reader;
+  frame_ctx_t ctx;
+  pd_params_t params;
+  unsigned char *data, *buffer;
+  int size, n;
+
+  if ((e->status = open_input(&reader, e->input, job->reader_mode, &e->res, &e->fps, &e->format, &e->bitdepth)) != 0)
+    return;
+
+  /* detector is reset rather than re-created for files with the same parameters: */
+  memset(&params, 0, sizeof(params));
+  params.width = e->res.width;
+  params.height = e->res.height;
+  params.format = e->format;
+  params.bitdepth = e->bitdepth;
+  params.asm_type = job->asm_type;
+  params.confidence = job->early_exit;
+  params.cascade = job->cascade;
+  params.crop_interval = job->crop_interval;
+  if ((st = take_batch_state(job, &params)) == NULL)
+    error(1, "Out of memory.\n");
+  if (st->pd != NULL && st->params.width == params.width && st->params.height == params.height && st->params.bitdepth == params.bitdepth) {
+    pd_reset(st->pd);
+  } else {
+    pd_destroy(st->pd);
+    st->pd = pd_create(&params);
+    st->params = params;
+  }
+  if (st->pd == NULL) {
+    e->status = 3;
+    memset(&st->params, 0, sizeof(st->params));
+    goto done;
+  }
+
+  /* frame buffer only grows: */
+  size = (reader.mode == READER_MMAP || reader.mode == READER_STREAM)? 0: (reader.mode == READER_LUMA)? (int)reader.luma_size: (int)reader.frame_size;
+  if (size > st->buffer_size) {
+    if ((buffer = (unsigned char *) realloc(st->buffer, size)) == NULL)
+      error(1, "Out of memory.\n");
+    st->buffer = buffer;
+    st->buffer_size = size;
+  }
+
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.reader = &reader;
+  ctx.pd = st->pd;
+  ctx.stride = e->res.width * ((e->bitdepth > 8)? 2: 1);
+  ctx.early_exit = (job->early_exit > 0);
+  if (job->sample_segments > 0 && (ctx.total_frames = reader_frame_count(&reader)) > (long long)job->sample_segments * job->sample_length) {
+    ctx.sample_segments = job->sample_segments;
+    ctx.sample_length = job->sample_length;
+  }
+  for (n=0; (data = read_frame(&ctx, st->buffer, st->frame)) != NULL; n++) {
+    analyze_frame(&ctx, data, st->frame);
+    commit_frame(&ctx, n, data, st->frame);
+  }
+  e->frames = n;
+  pd_get_result(st->pd, &e->result);
+
+done:
+  give_batch_state(job, st);
+  reader_close(&reader);
 }
 
-void calculate_deltas(unsigned char *frame, res_t *res, float *delta, float *delta_even, float *delta_odd)
+/*!
+ *  \brief Analyze all files of a list & print one summary line per file
+ *
+ *  Files are analyzed concurrently on a pool of threads (one file per thread), and
+ *  detectors & frame buffers are reused from one file to the next. The summary is
+ *  printed in list order once all files are done.
+ *
+ *  \returns    0 if success, 1 if list cannot be read or threads cannot be started
+ */
+static int run_batch (char *list, res_t *res, int format, int bitdepth, int threads, int reader_mode, int asm_type,
+                      double early_exit, int sample_segments, int sample_length, int cascade, int crop_interval)
 {
-  calculate_field_delta(frame, res, delta_even, delta_odd);
-  calculate_frame_delta(frame, res, delta);
+  batch_job_t job;
+  batch_entry_t *e;
+  batch_state_t *st;
+  thread_pool_t *pool = NULL;
+  int i, n;
+
+  if ((n = read_batch_list(list, res, format, bitdepth, &job.entries)) < 0) {
+    error(0, "Cannot read file list '%s'\n", list);
+    return 1;
+  }
+  job.reader_mode = reader_mode;
+  job.asm_type = asm_type;
+  job.early_exit = early_exit;
+  job.sample_segments = sample_segments;
+  job.sample_length = sample_length;
+  job.cascade = cascade;
+  job.crop_interval = crop_interval;
+  job.free_states = NULL;
+  pthread_mutex_init(&job.lock, NULL);
+
+  if (threads > 0 && (pool = thread_pool_create(threads)) == NULL) {
+    error(0, "Cannot start %d threads.\n", threads);
+    return 1;
+  }
+  if (pool != NULL)
+    thread_pool_run(pool, batch_file_task, &job, n);
+  else
+    for (i=0; i<n; i++) batch_file_task(&job, i);
+  thread_pool_destroy(pool);
+
+  /* summary (decided only with --early_exit, whose confidence it is tested at): */
+  printf("file,frames,scan_type,%stelecine,combed_frames,cadence_frames,drops,tff_votes,bff_votes,gamma_mean,status\n",
+         early_exit > 0? "decided,": "");
+  for (i=0; i<n; i++) {
+    e = &job.entries[i];
+    printf("%s,%d,%s,", e->input, e->frames, pd_scan_type_name(e->result.scan_type));
+    if (early_exit > 0)
+      printf("%d,", e->result.decided);
+    printf("%d,%d,%d,%d,%d,%d,%.4f,%s\n",
+           e->result.telecine, e->result.combed_frames, e->result.locked_frames, e->result.drops, e->result.tff_votes, e->result.bff_votes,
+           e->result.gamma_mean, e->status? input_errors[e->status]: "ok");
+    free(e->input);
+  }
+
+  while ((st = job.free_states) != NULL) {
+    job.free_states = st->next;
+    pd_destroy(st->pd);
+    pd_frame_destroy(st->frame);
+    free(st->buffer);
+    free(st);
+  }
+  pthread_mutex_destroy(&job.lock);
+  free(job.entries);
+  return 0;
 }
 
 /*!
@@ -363,106 +803,272 @@ int main (int argc, char* argv[])
   static int format = FORMAT_YUV420;     //!< default chroma format
   static char *temp_dir = NULL;                       // temporary directory
   static int bitdepth = 8;               //!< default bitdepth
+  static int threads = 0;                //!< number of analysis threads
+  static int band_threads = 0;           //!< number of row band threads
+  static int reader_mode = READER_STDIO; //!< input reader
+  static int asm_type = ASM_AUTO;        //!< kernel instruction set
+  static int trust_y4m = 0;              //!< report Y4M interlacing tag without analysis
+  static double early_exit = 0;          //!< confidence to stop at, 0 = read whole input
+  static int sample_segments = 0;        //!< number of sampled segments, 0 = read whole input
+  static int sample_length = 0;          //!< number of frames per sampled segment
+  static int cascade = 0;                //!< analyze decimated frames first
+  static int crop_interval = 0;          //!< frames between active area detections, 0 = analyze whole frames
+  static int chroma = 0;                 //!< analyze chroma planes too
+  static char *batch = NULL;             //!< file list for batch mode
+  static char *stats_log = NULL;         //!< binary stats log file
+  static int block_stats = 0;            //!< log per-block gamma in binary log
+  static int print_stats = 0;            //!< print stage instrumentation report
   static int verbose = 0;
 
   /* frame buffers: */
-  unsigned char *frame, *cur, *prev;
-
-  /* deltas */
-  float delta_frame;                  //current frame odd and even difference
-  float delta_even_fields;                 //continuous frames even and even difference
-  float delta_odd_fields;                 //continuous frames odd and odd difference
-
-  FILE *input_file; 
+  unsigned char *frame;
+  unsigned char *data;                   //!< frame data returned by reader
+
+  /* loss kernels: */
+  const loss_funcs_t *lf;
+  char *asm_env;
+
+  /* detector & frame processing stages: */
+  pd_params_t params;
+  pd_result_t res;
+  frame_ctx_t ctx;
+  pd_frame_t *stats;
+  pipeline_t pl;
+
+  frame_reader_t reader;
+  profile_t profile;
   FILE *f_delta_log; 
   int result;
 
-  /* create temporary dir and logs */
-  int keepfolders = 0;             //!< default not keep log files under /tmp
+  /* temporary dir & text log */
   char dirname[STRLEN], delta_log[STRLEN];
   char *input_name, *filename;
 
   /* other vars: */
-  int size, i;
-
-  /* define tuning param gamma */
-  float gamma=0.0;
+  long long total_frames;
+  int size, luma, buffer_size, i, k;
 
   /* print program name & version */
   version ();
 
-  /* parse command line: */
-  read_command_line(argc, argv, &input, &resolution, &framerate, &format, &temp_dir, &bitdepth, &verbose);
+  /* kernel instruction set may be overridden by environment, then by command line: */
+  if ((asm_env = getenv(ASM_ENV_VAR)) != NULL && get_asm(asm_env, &asm_type))
+    error (1, "Invalid %s value: %s\n", ASM_ENV_VAR, asm_env);
 
-  /* allocate frame buffers: */
-  size = frame_size(&resolution, format, bitdepth);
-  if (size <= 0) error (1, "Invalid video parameters.\n");
-  frame = (unsigned char*) malloc(size);
-  cur = (unsigned char*) malloc(size);
-  prev = (unsigned char*) malloc(size);
-  if (!cur || !prev) error(1, "Out of memory.\n"); 
+  /* parse command line: */
+  read_command_line(argc, argv, &input, &resolution, &framerate, &format, &temp_dir, &bitdepth, &threads, &band_threads, &reader_mode, &asm_type, &trust_y4m, &early_exit, &sample_segments, &sample_length, &cascade, &crop_interval, &chroma, &batch, &stats_log, &block_stats, &print_stats, &verbose);
+
+  /* select loss kernels: */
+  lf = get_loss_funcs(asm_type);
+  if (asm_type != ASM_AUTO && lf->asm_type != asm_type)
+    error (0, "Requested kernels are not supported by this CPU, using %s.\n", lf->name);
+  if (verbose)
+    printf ("Using %s kernels\n", lf->name);
+
+  /* the block map covers the active area, which is not the frame's block grid & may change */
+  if (block_stats && crop_interval > 0)
+    error (1, "Per-block gamma (--block_stats) is not supported with --active_area.\n");
+
+  /* batch mode: files of the list are analyzed by --threads workers, one file each */
+  if (batch != NULL && chroma)
+    error (1, "Chroma analysis is not supported in batch mode.\n");
+  if (batch != NULL)
+    return run_batch(batch, &resolution, format, bitdepth, threads, reader_mode, asm_type, early_exit, sample_segments, sample_length, cascade, crop_interval);
+
+  /* open input file, Y4M stream header overrides video parameters: */
+  if ((result = open_input(&reader, input, reader_mode, &resolution, &framerate, &format, &bitdepth)) != 0)
+    error(1, "%s: %s.\n", input, input_errors[result]);
+  if (reader.mode != reader_mode) {
+    /* pipes & devices are read sequentially: */
+    if (reader_mode != READER_STDIO)
+      error(0, "Cannot %s file '%s', reading it instead.\n", (reader_mode == READER_MMAP)? "map": "seek in", input);
+    reader_mode = reader.mode;
+  }
 
-  /* open input file: */
-  if ((input_file = fopen(input, "rb")) == NULL) 
-    error(1, "Cannot open file '%s'\n", input);
+  if (reader.y4m) {
+    if (verbose)
+      printf ("Y4M stream: %dx%d, %d/%d fps, %d-bit, %s\n", resolution.width, resolution.height, framerate.num, framerate.denom,
+              bitdepth, pd_scan_type_name(reader.y4m_info.scan_type));
 
-  /* print progress: */
-  if (verbose) 
-  {
-    printf ("Processing:\n  >");
-    keepfolders = 1;    // keep log files under debug mode
+    /* interlacing tag is trusted, if asked: */
+    if (trust_y4m && reader.y4m_info.scan_type != SCAN_UNKNOWN) {
+      printf ("Scan type: %s (from Y4M header)\n", pd_scan_type_name(reader.y4m_info.scan_type));
+      reader_close(&reader);
+      return 0;
+    }
   }
 
-  /* generate unique name for temp directory: */
-  result = make_temp_dir (dirname, STRLEN, temp_dir);
-  if (result) {
-    error(0, "Cannot create temp directory\n");
-    return result;
+  /* check presence of mandatory parameters: */
+  if (!framerate.num || !framerate.denom) error (1, "Video framerate must be specified.\n");
+  if (format == FORMAT_YUV400) chroma = 0;
+  if (chroma && reader.mode == READER_LUMA) error (1, "Chroma analysis needs whole frames, not --luma_only.\n");
+
+  /* frame & luma plane sizes: */
+  size = (int)reader.frame_size;
+  luma = (int)reader.luma_size;
+
+  /* sampled segments are found by seeking, whole input is read if they would overlap: */
+  total_frames = 0;
+  if (sample_segments > 0) {
+    if ((total_frames = reader_frame_count(&reader)) < 0)
+      error(1, "Cannot seek in '%s', sampling needs a regular file.\n", input);
+    if ((long long)sample_segments * sample_length >= total_frames) {
+      if (verbose)
+        printf ("Sampled segments cover all %lld frames, reading whole input\n", total_frames);
+      sample_segments = 0;
+    }
   }
 
-  input_name = basename(input);
-  input_name = remove_filename_extension(input_name);
-  memset(delta_log, 0, STRLEN);
-  sprintf(delta_log, "%s%c%s", dirname,  DIRSEP, input_name);
-
-  filename = strcat(delta_log,".csv");
-  f_delta_log = fopen(filename, "w");
-  fprintf (f_delta_log, "\tdelta_frame,delta_even,delta_odd,gamma\n");
+  /* mapped & streamed frames are analyzed in place, luma-only reader needs luma buffers only: */
+  buffer_size = (reader_mode == READER_MMAP || reader_mode == READER_STREAM)? 0: (reader_mode == READER_LUMA)? luma: size;
+  frame = NULL;
+  if (buffer_size > 0 && (frame = (unsigned char*) malloc(buffer_size)) == NULL)
+    error(1, "Out of memory.\n");
 
-  /* main loop: */
-  for (i=0; ; i++) 
+  /* text log of frame statistics, under a unique temp directory, in verbose mode only: */
+  f_delta_log = NULL;
+  if (verbose)
   {
+    result = make_temp_dir (dirname, STRLEN, temp_dir);
+    if (result) {
+      error(0, "Cannot create temp directory\n");
+      return result;
+    }
 
-    /* read frame: */
-    if (fread (frame, size, 1, input_file) != 1)
-      break;
-
-    calculate_deltas(frame, &resolution, &delta_frame, &delta_even_fields, &delta_odd_fields);
-    gamma = delta_frame / (delta_even_fields + delta_odd_fields + 0.00001);
-    fprintf (f_delta_log, "%8.5f,%8.5f,%8.5f,%8.5f\n", delta_frame, delta_even_fields, delta_odd_fields, gamma);
+    input_name = strcmp(input, "-")? basename(input): "stdin";
+    input_name = remove_filename_extension(input_name);
+    memset(delta_log, 0, STRLEN);
+    sprintf(delta_log, "%s%c%s", dirname,  DIRSEP, input_name);
 
-    /* print progress: */
-    if (verbose && i > 0 && i % 10 == 0)
-      printf(".");
+    filename = strcat(delta_log,".csv");
+    f_delta_log = fopen(filename, "w");
+    fprintf (f_delta_log, "\tdelta_frame,delta_even,delta_odd,gamma,combed_blocks,match,drop,phase,order%s\n", chroma? ",gamma_u,gamma_v": "");
   }
 
-  fclose (f_delta_log);
+  /* binary log of frame statistics, written by a background thread: */
+  ctx.stats_log = NULL;
+  if (stats_log != NULL && (ctx.stats_log = stats_log_open(stats_log, &resolution, block_stats)) == NULL)
+    error(1, "Cannot create stats log %s\n", stats_log);
+
+  /* print progress: */
+  if (verbose) 
+    printf ("Processing:\n  >");
 
-  /* nuke all log files */
-  if (!keepfolders) {
-    _unlink(delta_log);
-    _rmdir(dirname);
+  /* create detector: */
+  params.width = resolution.width;
+  params.height = resolution.height;
+  params.format = format;
+  params.bitdepth = bitdepth;
+  params.asm_type = asm_type;
+  params.band_threads = band_threads;
+  params.confidence = early_exit;
+  params.cascade = cascade;
+  params.crop_interval = crop_interval;
+  params.chroma = chroma;
+  if ((ctx.pd = pd_create(&params)) == NULL)
+    error(1, "Cannot create detector: invalid video parameters, out of memory, or cannot start %d band threads.\n", band_threads);
+
+  ctx.reader = &reader;
+  ctx.stride = resolution.width * ((bitdepth > 8)? 2: 1);
+  ctx.luma_size = luma;
+  ctx.chroma_size = (size - luma) / 2;
+  ctx.chroma_stride = chroma? ((format == FORMAT_YUV444)? ctx.stride: (resolution.width / 2) * ((bitdepth > 8)? 2: 1)): 0;
+  ctx.f_delta_log = f_delta_log;
+  ctx.early_exit = (early_exit > 0);
+  ctx.exit_frame = 0;
+  ctx.stop = 0;
+  ctx.sample_segments = sample_segments;
+  ctx.sample_length = sample_length;
+  ctx.total_frames = total_frames;
+  ctx.frames_read = 0;
+  ctx.verbose = verbose;
+  ctx.profile = NULL;
+  if (print_stats) {
+    profile_init(&profile);
+    ctx.profile = &profile;
   }
 
+  if (threads > 0)
+  {
+    /* frame-parallel pipeline: */
+    pl.threads = threads;
+    pl.frame_size = buffer_size;
+    pl.read = read_frame;
+    pl.analyze = analyze_frame;
+    pl.commit = commit_frame;
+    pl.arg = &ctx;
+    if ((i = run_pipeline(&pl)) < 0)
+      error(1, "Cannot start %d analysis threads.\n", threads);
+  }
+  else
+  {
+    /* main loop: */
+    if ((stats = pd_frame_create()) == NULL)
+      error(1, "Out of memory.\n");
+    for (i=0; (data = read_frame(&ctx, frame, stats)) != NULL; i++) 
+    {
+      analyze_frame(&ctx, data, stats);
+      commit_frame(&ctx, i, data, stats);
+    }
+    pd_frame_destroy(stats);
+  }
+
+  pd_get_result(ctx.pd, &res);
+  pd_destroy(ctx.pd);
+  if (f_delta_log != NULL)
+    fclose (f_delta_log);
+  if (stats_log_close(ctx.stats_log))
+    error(0, "Cannot write stats log %s\n", stats_log);
+
   /* progress indicator: */
   if (verbose) {
     printf("<\n");
     printf("=> %d frames processed\n", i);
+    printf("=> %d frames with combed blocks\n", res.combed_frames);
+    printf("=> 3:2 cadence locked on %d frames, %d breaks, %d frames to drop\n", res.locked_frames, res.breaks, res.drops);
+    printf("=> field order votes: %d tff, %d bff\n", res.tff_votes, res.bff_votes);
+    if (ctx.early_exit) {
+      printf("=> gamma %.4f +/- %.4f, delta_even %.4f +/- %.4f, delta_odd %.4f +/- %.4f\n",
+             res.gamma_mean, res.gamma_stddev, res.delta_even_mean, res.delta_even_stddev, res.delta_odd_mean, res.delta_odd_stddev);
+      printf("=> %d of %d observed frames combed, log-likelihood ratio %.3f\n", res.combed, res.observed, res.llr);
+    }
+    printf("=> median gamma %.4f, median field delta difference %.4f\n", res.gamma_median, res.field_diff_median);
   }
 
+  /* frames covered by sampling: */
+  if (sample_segments > 0) {
+    printf("Sampled %d of %lld frames:", i, total_frames);
+    for (k=0; k*sample_length < i; k++)
+      printf("%s %lld-%lld", k? ",": "", sample_start(&ctx, k), sample_start(&ctx, k) + min(sample_length, i - k*sample_length) - 1);
+    printf("\n");
+  }
+
+  /* area inside black bars: */
+  if (crop_interval > 0)
+    printf("Active area: %dx%d at (%d,%d)\n", res.area_width, res.area_height, res.area_x, res.area_y);
+
+  /* chroma planes: */
+  if (chroma)
+    printf("Chroma: gamma U %.4f, V %.4f (mean of %d frames), %d frames combed in chroma only\n",
+           res.gamma_u_mean, res.gamma_v_mean, res.chroma_frames, res.chroma_combed_frames);
+
+  /* frames the cascade could not settle on decimated statistics: */
+  if (cascade)
+    printf("Cascade: %d of %d frames escalated to full resolution\n", res.escalated_frames, res.frames);
+
+  /* scan type classified from histograms: */
+  printf("Scan type: %s%s", pd_scan_type_name(res.scan_type), (res.scan_type != SCAN_PROGRESSIVE && res.telecine)? ", 3:2 telecine": "");
+  if (ctx.exit_frame > 0)
+    printf(" (early exit after %d frames, confidence %g)", ctx.exit_frame, early_exit);
+  printf("\n");
+
+  /* stage timings: */
+  if (print_stats)
+    profile_report(&profile, i, (long long)resolution.width * resolution.height * ((bitdepth > 8)? 2: 1),
+                   (reader.mode == READER_LUMA)? reader.luma_size: reader.frame_size);
+
   /* close files, free buffers & exit: */
-  fclose(input_file); 
-  free(prev); 
-  free(cur); 
+  reader_close(&reader);
+  free(frame);
   return 0;
 }
\ No newline at end of file
@@ -68,6 +68,30 @@ void run_cpuid(unsigned int eax, unsigned int ecx, int* abcd)
 #endif
 }
 
+/* Check that OS saves XMM/YMM state on context switch (XCR0 bits 1, 2) */
+static int os_supports_ymm_state()
+{
+#if defined(_MSC_VER)
+    return (_xgetbv(0) & 6) == 6;
+#else
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__ ( "xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0) );
+    return (xcr0_lo & 6) == 6;
+#endif
+}
+
+/* Check that OS saves opmask & ZMM state on context switch (XCR0 bits 5, 6, 7) */
+static int os_supports_zmm_state()
+{
+#if defined(_MSC_VER)
+    return (_xgetbv(0) & 0xE6) == 0xE6;
+#else
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__ ( "xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0) );
+    return (xcr0_lo & 0xE6) == 0xE6;
+#endif
+}
+
 int check_4th_gen_intel_core_features()
 {
     int abcd[4];
@@ -80,6 +104,8 @@ int check_4th_gen_intel_core_features()
     run_cpuid( 1, 0, abcd );
     if ( (abcd[2] & fma_movbe_osxsave_mask) != fma_movbe_osxsave_mask ) 
         return 0;
+    if ( !os_supports_ymm_state() )
+        return 0;
  
     /*  CPUID.(EAX=07H, ECX=0H):EBX.AVX2[bit 5]==1  &&
         CPUID.(EAX=07H, ECX=0H):EBX.BMI1[bit 3]==1  &&
@@ -93,6 +119,31 @@ int check_4th_gen_intel_core_features()
         return 0;
     return 1;
 }
+
+/* AVX-512 features: 1 for AVX-512BW, 2 for AVX-512BW with VNNI, 0 if not available */
+static int check_avx512_features()
+{
+    int abcd[4];
+    int avx512f_bw_mask = (1 << 16) | (1 << 30);
+
+    if ( !check_4th_gen_intel_core_features() || !os_supports_zmm_state() )
+        return 0;
+    /* CPUID.(EAX=07H, ECX=0H):EBX.AVX512F[bit 16]==1 && EBX.AVX512BW[bit 30]==1 */
+    run_cpuid( 7, 0, abcd );
+    if ( (abcd[1] & avx512f_bw_mask) != avx512f_bw_mask )
+        return 0;
+    /* CPUID.(EAX=07H, ECX=0H):ECX.AVX512_VNNI[bit 11]==1 */
+    return (abcd[2] & (1 << 11))? 2: 1;
+}
+
+static int check_sse2_features()
+{
+    int abcd[4];
+    /* CPUID.(EAX=01H, ECX=0H):EDX.SSE2[bit 26]==1 */
+    run_cpuid( 1, 0, abcd );
+    return (abcd[3] & (1 << 26)) != 0;
+}
+
 static int can_use_intel_core_4th_gen_features()
 {
     static int the_4th_gen_features_available = -1;
@@ -102,15 +153,24 @@ static int can_use_intel_core_4th_gen_features()
     return the_4th_gen_features_available;
 }
 
-// Returns ASM Type based on system configuration. AVX512 - 111, AVX2 - 011, NONAVX2 - 001, C - 000
+// Returns ASM Type based on system configuration. AVX512 VNNI - 1111, AVX512 - 111, AVX2 - 011, NONAVX2 - 001, C - 000
 // Using bit-fields, the fastest function will always be selected based on the available functions in the function arrays
 unsigned int get_cpu_asm_type()
 {
 	unsigned int asm_type = 0;
+#ifndef NON_AVX512_SUPPORT
+  static int avx512 = -1;
+  if (avx512 < 0)
+      avx512 = check_avx512_features();
+  if (avx512 > 0){
+      asm_type = (avx512 == 2)? 15: 7; // bit-field
+  }
+  else
+#endif
   if (can_use_intel_core_4th_gen_features() == 1){
       asm_type = 3; // bit-field
   }
-  else{
+  else if (check_sse2_features()){
       asm_type = 1; // bit-field
   }
   
@@ -287,3 +347,14 @@ char *remove_filename_extension (char* mystr)
   // Return the modified string.
   return retstr;
 }
+
+/* Name of scan order type */
+const char *pd_scan_type_name (int scan_type)
+{
+  switch (scan_type) {
+    case SCAN_PROGRESSIVE:    return "progressive";
+    case SCAN_INTERLACE_TFF:  return "interlaced tff";
+    case SCAN_INTERLACE_BFF:  return "interlaced bff";
+  }
+  return "unknown";
+}
@@ -0,0 +1,159 @@
+/*!
+ *  \file     pipeline.c
+ *  \brief    Frame-parallel analysis pipeline
+ *
+ *  Reader thread fills a pool of frame buffers (and prepares their analysis in frame
+ *  order), N worker threads analyze frames concurrently, and the calling thread commits
+ *  results strictly in frame order.
+ *  Stages exchange buffer indices through bounded lock-free queues:
+ *
+ *    free_q -> [reader] -> work_q -> [workers] -> done_q -> [commit] -> free_q
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pattern_detector.h"
+
+#define END_OF_INPUT  -1    //!< queue marker sent after the last frame
+
+/*! Frame buffer slot */
+typedef struct {
+  unsigned char *buffer;        //!< frame buffer owned by slot
+  unsigned char *data;          //!< frame data returned by reader (buffer or reader-owned memory)
+  int index;                    //!< frame index
+  frame_stats_t stats;          //!< analysis results
+} slot_t;
+
+/*! Pipeline state shared by all stages */
+typedef struct {
+  pipeline_t *pl;
+  slot_t *slots;
+  int num_slots;
+  queue_t free_q, work_q, done_q;
+  int frames;                   //!< number of frames read (valid once reader has finished)
+} pipeline_state_t;
+
+/*! Reader stage: fill free slots with frames */
+static void *reader_thread (void *arg)
+{
+  pipeline_state_t *ps = (pipeline_state_t *) arg;
+  slot_t *slot;
+  int i, s;
+
+  for (i=0; ; i++) {
+    s = queue_pop_wait(&ps->free_q);
+    slot = &ps->slots[s];
+    if ((slot->data = ps->pl->read(ps->pl->arg, slot->buffer, &slot->stats)) == NULL) {
+      queue_push_wait(&ps->free_q, s);
+      break;
+    }
+    slot->index = i;
+    queue_push_wait(&ps->work_q, s);
+  }
+
+  ps->frames = i;
+  for (i=0; i<ps->pl->threads; i++)
+    queue_push_wait(&ps->work_q, END_OF_INPUT);
+  return NULL;
+}
+
+/*! Worker stage: analyze frames in any order */
+static void *worker_thread (void *arg)
+{
+  pipeline_state_t *ps = (pipeline_state_t *) arg;
+  slot_t *slot;
+  int s;
+
+  while ((s = queue_pop_wait(&ps->work_q)) != END_OF_INPUT) {
+    slot = &ps->slots[s];
+    ps->pl->analyze(ps->pl->arg, slot->data, &slot->stats);
+    queue_push_wait(&ps->done_q, s);
+  }
+  queue_push_wait(&ps->done_q, END_OF_INPUT);
+  return NULL;
+}
+
+/*!
+ *  \brief Run frame-parallel pipeline until the reader reaches end of input
+ *
+ *  \param[in]  pl  - pipeline parameters & stage callbacks
+ *
+ *  \returns    number of frames processed, or -1 if buffers or threads cannot be created
+ */
+int run_pipeline (pipeline_t *pl)
+{
+  pipeline_state_t ps;
+  pthread_t reader, *workers;
+  int *reorder;                 // slot of each uncommitted frame, indexed by frame % num_slots
+  int i, s, next = 0, finished = 0, started = 0, result = -1;
+
+  /* enough slots to keep all workers busy while reader & commit stages run ahead/behind */
+  memset(&ps, 0, sizeof(ps));
+  ps.pl = pl;
+  ps.num_slots = 2 * pl->threads + 2;
+  ps.slots = (slot_t *) calloc(ps.num_slots, sizeof(slot_t));
+  reorder = (int *) malloc(ps.num_slots * sizeof(int));
+  workers = (pthread_t *) malloc(pl->threads * sizeof(pthread_t));
+  if (!ps.slots || !reorder || !workers) goto cleanup;
+  if (queue_init(&ps.free_q, ps.num_slots) || queue_init(&ps.work_q, ps.num_slots + pl->threads)
+   || queue_init(&ps.done_q, ps.num_slots + pl->threads)) goto cleanup;
+  for (s=0; s<ps.num_slots; s++) {
+    if (pl->frame_size > 0 && (ps.slots[s].buffer = (unsigned char *) malloc(pl->frame_size)) == NULL) goto cleanup;
+    queue_push(&ps.free_q, s);
+    reorder[s] = -1;
+  }
+
+  /* start workers & reader: */
+  for (started=0; started<pl->threads; started++)
+    if (pthread_create(&workers[started], NULL, worker_thread, &ps)) break;
+  if (started == 0) goto cleanup;
+  for (i=started; i<pl->threads; i++)   // workers that failed to start count as finished
+    queue_push_wait(&ps.done_q, END_OF_INPUT);
+  if (pthread_create(&reader, NULL, reader_thread, &ps)) {
+    for (i=0; i<started; i++) queue_push_wait(&ps.work_q, END_OF_INPUT);
+    for (i=0; i<started; i++) pthread_join(workers[i], NULL);
+    goto cleanup;
+  }
+
+  /* commit stage: release results in frame order */
+  while (finished < pl->threads) {
+    if ((s = queue_pop_wait(&ps.done_q)) == END_OF_INPUT) {
+      finished ++;
+      continue;
+    }
+    reorder[ps.slots[s].index % ps.num_slots] = s;
+    while ((s = reorder[next % ps.num_slots]) >= 0) {
+      pl->commit(pl->arg, next, ps.slots[s].data, &ps.slots[s].stats);
+      reorder[next % ps.num_slots] = -1;
+      queue_push_wait(&ps.free_q, s);
+      next ++;
+    }
+  }
+
+  pthread_join(reader, NULL);
+  for (i=0; i<started; i++)
+    pthread_join(workers[i], NULL);
+  result = next;
+
+cleanup:
+  if (ps.slots)
+    for (s=0; s<ps.num_slots; s++) {
+      free(ps.slots[s].buffer);
+      block_map_free(&ps.slots[s].stats.blocks);
+      block_map_free(&ps.slots[s].stats.chroma_blocks[0]);
+      block_map_free(&ps.slots[s].stats.chroma_blocks[1]);
+      field_sig_free(&ps.slots[s].stats.fields);
+    }
+  queue_free(&ps.free_q); queue_free(&ps.work_q); queue_free(&ps.done_q);
+  free(ps.slots); free(reorder); free(workers);
+  return result;
+}
@@ -0,0 +1,109 @@
+/*!
+ *  \file     profile.c
+ *  \brief    Per-stage instrumentation of frame processing
+ *
+ *  Stage durations are taken on the monotonic clock (common/timer) and accumulated into
+ *  log-scale histograms of PROFILE_BINS_PER_OCTAVE bins per power of 2, so percentiles
+ *  are reported within ~4% from fixed memory, for streams of any length. Counters are
+ *  updated atomically, as analysis runs on several threads. Stages call in only when
+ *  instrumentation is enabled (--stats).
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pattern_detector.h"
+
+#define PROFILE_BINS    (PROFILE_OCTAVES * PROFILE_BINS_PER_OCTAVE)
+
+static const char *stage_names[STAGE_TOTAL] = {"read", "analyze", "classify", "log", "frame"};
+
+/*! Start instrumentation: clear counters & set time origin */
+void profile_init (profile_t *prof)
+{
+  memset(prof, 0, sizeof(profile_t));
+  get_time(&prof->start);
+}
+
+/*! Current time [in ns since profile_init()] */
+int64_t profile_now (profile_t *prof)
+{
+  timestamp_t now;
+  get_time(&now);
+  return (int64_t)(elapsed_time(&prof->start, &now) * 1e9);
+}
+
+/*! Histogram bin of duration */
+static int duration_bin (int64_t ns)
+{
+  int b = (ns > 1)? (int)(PROFILE_BINS_PER_OCTAVE * log2((double)ns)): 0;
+  return min(b, PROFILE_BINS - 1);
+}
+
+/*! Lower bound of histogram bin [in ns] */
+static double bin_start (int b)
+{
+  return (b > 0)? exp2((double)b / PROFILE_BINS_PER_OCTAVE): 0.0;
+}
+
+/*! Add duration of one execution of stage (thread-safe) */
+void profile_add (profile_t *prof, int stage, int64_t ns)
+{
+  stage_counter_t *sc = &prof->stages[stage];
+  uint64_t d = (ns > 0)? (uint64_t)ns: 0, m;
+
+  __atomic_fetch_add(&sc->count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&sc->total_ns, d, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&sc->bins[duration_bin(ns)], 1, __ATOMIC_RELAXED);
+  m = __atomic_load_n(&sc->max_ns, __ATOMIC_RELAXED);
+  while (d > m && !__atomic_compare_exchange_n(&sc->max_ns, &m, d, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+/*! Duration below which fraction q of executions lie [in ns], interpolated within bins */
+static double stage_percentile (const stage_counter_t *sc, double q)
+{
+  double target = q * sc->count, n = 0;
+  int b;
+
+  for (b=0; b<PROFILE_BINS; b++) {
+    if (sc->bins[b] > 0 && n + sc->bins[b] >= target)
+      return min((double)sc->max_ns, bin_start(b) + (bin_start(b + 1) - bin_start(b)) * (target - n) / sc->bins[b]);
+    n += sc->bins[b];
+  }
+  return (double)sc->max_ns;
+}
+
+/*!
+ *  \brief Print end-of-run report: totals, per-frame percentiles & throughput
+ *
+ *  \param[in]  prof        - instrumentation
+ *  \param[in]  frames      - number of frames processed
+ *  \param[in]  luma_bytes  - size of luma plane analyzed per frame [in bytes]
+ *  \param[in]  read_bytes  - size read per frame [in bytes]
+ */
+void profile_report (profile_t *prof, int frames, long long luma_bytes, long long read_bytes)
+{
+  double wall = profile_now(prof) / 1e9;
+  const stage_counter_t *sc;
+  int s;
+
+  printf("Stage statistics (%d frames, %.3f s):\n", frames, wall);
+  printf("  %-9s %10s %10s %10s %10s %10s %10s\n", "stage", "total [s]", "mean [us]", "p50 [us]", "p95 [us]", "p99 [us]", "max [us]");
+  for (s=0; s<STAGE_TOTAL; s++) {
+    sc = &prof->stages[s];
+    if (sc->count == 0) continue;
+    printf("  %-9s %10.3f %10.1f %10.1f %10.1f %10.1f %10.1f\n", stage_names[s], sc->total_ns / 1e9, sc->total_ns / 1e3 / sc->count,
+           stage_percentile(sc, 0.50) / 1e3, stage_percentile(sc, 0.95) / 1e3, stage_percentile(sc, 0.99) / 1e3, sc->max_ns / 1e3);
+  }
+  if (wall > 0)
+    printf("Throughput: %.1f fps, %.3f GB/s luma analyzed, %.3f GB/s read\n", frames / wall,
+           frames * (double)luma_bytes / wall / 1e9, frames * (double)read_bytes / wall / 1e9);
+}
@@ -0,0 +1,144 @@
+/*!
+ *  \file     queue.c
+ *  \brief    Bounded lock-free multi-producer / multi-consumer queue
+ *
+ *  Array-based queue with per-cell sequence numbers (D. Vyukov's design). Producers and
+ *  consumers only contend on a CAS of the head or tail index, and never take a lock.
+ *  Used to pass frame buffer indices between pipeline stages.
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <sched.h>
+#include <time.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "pattern_detector.h"
+
+/*!
+ *  \brief Initialize queue
+ *
+ *  \param[in,out] q         - queue
+ *  \param[in]     capacity  - min number of elements, rounded up to power of 2
+ *
+ *  \returns    0 if success, !0 if out of memory
+ */
+int queue_init (queue_t *q, int capacity)
+{
+  size_t i, size = 2;
+  while (size < (size_t)capacity) size <<= 1;
+
+  if ((q->cells = (queue_cell_t *) malloc(size * sizeof(queue_cell_t))) == NULL)
+    return 1;
+  for (i=0; i<size; i++)
+    q->cells[i].seq = i;
+  q->mask = size - 1;
+  q->head = q->tail = 0;
+  return 0;
+}
+
+/*! Release queue memory */
+void queue_free (queue_t *q)
+{
+  free(q->cells);
+  q->cells = NULL;
+}
+
+/*!
+ *  \brief Append value to the queue
+ *
+ *  \returns    0 if success, 1 if queue is full
+ */
+int queue_push (queue_t *q, int value)
+{
+  queue_cell_t *cell;
+  size_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED), seq;
+  intptr_t dif;
+
+  for (;;) {
+    cell = &q->cells[pos & q->mask];
+    seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    dif = (intptr_t)seq - (intptr_t)pos;
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        break;
+    } else if (dif < 0) {
+      return 1;   // full
+    } else {
+      pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    }
+  }
+
+  cell->value = value;
+  __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/*!
+ *  \brief Remove value from the head of the queue
+ *
+ *  \returns    0 if success, 1 if queue is empty
+ */
+int queue_pop (queue_t *q, int *value)
+{
+  queue_cell_t *cell;
+  size_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED), seq;
+  intptr_t dif;
+
+  for (;;) {
+    cell = &q->cells[pos & q->mask];
+    seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    dif = (intptr_t)seq - (intptr_t)(pos + 1);
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        break;
+    } else if (dif < 0) {
+      return 1;   // empty
+    } else {
+      pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    }
+  }
+
+  *value = cell->value;
+  __atomic_store_n(&cell->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/*! Back off after a failed push/pop: spin briefly, then yield, then sleep */
+static void backoff (int *spins)
+{
+#ifndef _MSC_VER
+  struct timespec ts = {0, 50000};
+  if (++*spins < 16) return;
+  if (*spins < 64) sched_yield();
+  else nanosleep(&ts, NULL);
+#else
+  if (++*spins >= 16) Sleep(*spins < 64? 0: 1);
+#endif
+}
+
+/*! Append value, waiting while the queue is full */
+void queue_push_wait (queue_t *q, int value)
+{
+  int spins = 0;
+  while (queue_push(q, value)) backoff(&spins);
+}
+
+/*! Remove value, waiting while the queue is empty */
+int queue_pop_wait (queue_t *q)
+{
+  int spins = 0, value;
+  while (queue_pop(q, &value)) backoff(&spins);
+  return value;
+}
@@ -0,0 +1,221 @@
+/*!
+ *  \file     stats_log.c
+ *  \brief    Binary columnar per-frame stats log
+ *
+ *  Frame statistics are stored in binary, one column per statistic, in fixed-size
+ *  chunks of STATS_LOG_CHUNK_FRAMES frames (see stats_log_header_t), so that the file
+ *  can be memory-mapped & any column of any frame located without parsing. The commit
+ *  stage fills one chunk while a background thread writes the previous one:
+ *
+ *    [commit] -> chunk full -> [writer thread] -> fwrite
+ *
+ *  so the analysis never waits on formatting, stdio locking or disk, unless the writer
+ *  falls a whole chunk behind.
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pattern_detector.h"
+
+/* size of column entries [in bytes] */
+static const int column_sizes[STATS_COLUMNS] = {4, 4, 4, 4, 4, 4, 1, 1, 1, 1, 4};
+
+#define CHUNK_HEADER_SIZE   8       //!< frame count & reserved bytes at the start of each chunk
+
+/*! Stats log writer state */
+struct stats_log {
+  FILE *f;
+  stats_log_header_t header;
+  unsigned char *chunks[2];   //!< chunk being filled & chunk being written
+  int fill;                   //!< index of chunk being filled
+  int count;                  //!< number of frames in chunk being filled
+  size_t offsets[STATS_COLUMNS];  //!< column offsets within chunks
+  int blocks;                 //!< number of per-block gamma entries per frame, 0 if not logged
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int pending;                //!< !0 while the other chunk waits for / is being written
+  int done;                   //!< writer thread exits once pending chunk is written
+  int error;                  //!< !0 if a write failed
+};
+
+/*! Offset of column within chunks [in bytes] */
+size_t stats_log_column (const stats_log_header_t *header, int column)
+{
+  size_t offset = CHUNK_HEADER_SIZE;
+  int c;
+
+  for (c=0; c<column; c++)
+    offset += (size_t)column_sizes[c] * header->chunk_frames * ((c == STATS_BLOCK_GAMMA)? header->block_cols * header->block_rows: 1);
+  return offset;
+}
+
+/*! Writer thread: write full chunks handed over by stats_log_push() */
+static void *writer_thread (void *arg)
+{
+  stats_log_t *log = (stats_log_t *) arg;
+  unsigned char *chunk;
+
+  pthread_mutex_lock(&log->lock);
+  for (;;) {
+    while (!log->pending && !log->done)
+      pthread_cond_wait(&log->cond, &log->lock);
+    if (!log->pending)
+      break;
+    chunk = log->chunks[!log->fill];
+    pthread_mutex_unlock(&log->lock);
+    if (fwrite(chunk, log->header.chunk_size, 1, log->f) != 1)
+      log->error = 1;
+    pthread_mutex_lock(&log->lock);
+    log->pending = 0;
+    pthread_cond_broadcast(&log->cond);
+  }
+  pthread_mutex_unlock(&log->lock);
+  return NULL;
+}
+
+/*! Hand chunk being filled over to writer thread, once the previous one is written */
+static void submit_chunk (stats_log_t *log)
+{
+  unsigned char *chunk = log->chunks[log->fill];
+
+  memcpy(chunk, &log->count, sizeof(uint32_t));
+  pthread_mutex_lock(&log->lock);
+  while (log->pending)
+    pthread_cond_wait(&log->cond, &log->lock);
+  log->pending = 1;
+  log->fill = !log->fill;
+  pthread_cond_broadcast(&log->cond);
+  pthread_mutex_unlock(&log->lock);
+
+  log->count = 0;
+  memset(log->chunks[log->fill], 0, log->header.chunk_size);
+}
+
+/*!
+ *  \brief Create binary stats log & start its writer thread
+ *
+ *  \param[in]  filename     - log file name
+ *  \param[in]  res          - frame resolution
+ *  \param[in]  block_stats  - !0 to log the gamma of each block
+ *
+ *  \returns    log, or NULL if file cannot be created, out of memory, or thread cannot be started
+ */
+stats_log_t *stats_log_open (const char *filename, res_t *res, int block_stats)
+{
+  stats_log_t *log;
+  int c;
+
+  if ((log = (stats_log_t *) calloc(1, sizeof(stats_log_t))) == NULL)
+    return NULL;
+  memcpy(log->header.magic, STATS_LOG_MAGIC, sizeof(STATS_LOG_MAGIC));
+  log->header.version = STATS_LOG_VERSION;
+  log->header.header_size = sizeof(stats_log_header_t);
+  log->header.chunk_frames = STATS_LOG_CHUNK_FRAMES;
+  log->header.width = res->width;
+  log->header.height = res->height;
+  if (block_stats) {
+    log->header.block_cols = (res->width + BLOCK_WIDTH - 1) / BLOCK_WIDTH;
+    log->header.block_rows = (res->height + BLOCK_HEIGHT - 1) / BLOCK_HEIGHT;
+  }
+  log->blocks = log->header.block_cols * log->header.block_rows;
+  log->header.chunk_size = (uint32_t)stats_log_column(&log->header, STATS_COLUMNS);
+  for (c=0; c<STATS_COLUMNS; c++)
+    log->offsets[c] = stats_log_column(&log->header, c);
+
+  log->chunks[0] = (unsigned char *) calloc(1, log->header.chunk_size);
+  log->chunks[1] = (unsigned char *) calloc(1, log->header.chunk_size);
+  if (!log->chunks[0] || !log->chunks[1] || (log->f = fopen(filename, "wb")) == NULL)
+    goto fail;
+  if (fwrite(&log->header, sizeof(stats_log_header_t), 1, log->f) != 1)
+    goto fail;
+
+  pthread_mutex_init(&log->lock, NULL);
+  pthread_cond_init(&log->cond, NULL);
+  if (pthread_create(&log->thread, NULL, writer_thread, log)) {
+    pthread_mutex_destroy(&log->lock);
+    pthread_cond_destroy(&log->cond);
+    goto fail;
+  }
+  return log;
+
+fail:
+  if (log->f) fclose(log->f);
+  free(log->chunks[0]);
+  free(log->chunks[1]);
+  free(log);
+  return NULL;
+}
+
+/*!
+ *  \brief Append statistics of next frame, called in frame order
+ *
+ *  \param[in]  log     - stats log
+ *  \param[in]  frame   - input frame number
+ *  \param[in]  stats   - frame statistics
+ *  \param[in]  fr      - frame statistics & field matching decision
+ */
+void stats_log_push (stats_log_t *log, int frame, const frame_stats_t *stats, const pd_frame_result_t *fr)
+{
+  unsigned char *chunk = log->chunks[log->fill];
+  int i = log->count;
+  int32_t combed = fr->combed_blocks;
+  int8_t order = (fr->order == SCAN_INTERLACE_TFF)? 't': (fr->order == SCAN_INTERLACE_BFF)? 'b': '-';
+
+  ((int32_t *)(chunk + log->offsets[STATS_FRAME]))[i] = frame;
+  ((float *)(chunk + log->offsets[STATS_DELTA_FRAME]))[i] = fr->delta_frame;
+  ((float *)(chunk + log->offsets[STATS_DELTA_EVEN]))[i] = fr->delta_even;
+  ((float *)(chunk + log->offsets[STATS_DELTA_ODD]))[i] = fr->delta_odd;
+  ((float *)(chunk + log->offsets[STATS_GAMMA]))[i] = fr->gamma;
+  ((int32_t *)(chunk + log->offsets[STATS_COMBED_BLOCKS]))[i] = combed;
+  ((int8_t *)(chunk + log->offsets[STATS_MATCH]))[i] = fr->match;
+  ((int8_t *)(chunk + log->offsets[STATS_DROP]))[i] = (int8_t)fr->drop;
+  ((int8_t *)(chunk + log->offsets[STATS_PHASE]))[i] = (int8_t)fr->phase;
+  ((int8_t *)(chunk + log->offsets[STATS_ORDER]))[i] = order;
+  if (log->blocks > 0 && stats->blocks.cols * stats->blocks.rows == log->blocks)
+    block_map_gamma(&stats->blocks, (float *)(chunk + log->offsets[STATS_BLOCK_GAMMA]) + (size_t)i * log->blocks);
+
+  log->header.frames ++;
+  if (++log->count == (int)log->header.chunk_frames)
+    submit_chunk(log);
+}
+
+/*!
+ *  \brief Write last chunk & frame count, stop writer thread & close log
+ *
+ *  \returns    0 if success, !0 if a write failed
+ */
+int stats_log_close (stats_log_t *log)
+{
+  int error;
+
+  if (log == NULL) return 0;
+  if (log->count > 0)
+    submit_chunk(log);
+  pthread_mutex_lock(&log->lock);
+  log->done = 1;
+  pthread_cond_broadcast(&log->cond);
+  pthread_mutex_unlock(&log->lock);
+  pthread_join(log->thread, NULL);
+
+  /* frame count is known now; non-seekable outputs keep 0 */
+  if (fseek(log->f, 0, SEEK_SET) == 0 && fwrite(&log->header, sizeof(stats_log_header_t), 1, log->f) != 1)
+    log->error = 1;
+  error = log->error | (fclose(log->f) != 0);
+
+  pthread_mutex_destroy(&log->lock);
+  pthread_cond_destroy(&log->cond);
+  free(log->chunks[0]);
+  free(log->chunks[1]);
+  free(log);
+  return error;
+}
@@ -0,0 +1,276 @@
+/*!
+ *  \file     thread_pool.c
+ *  \brief    Work-stealing thread pool
+ *
+ *  Each worker owns a deque of tasks. thread_pool_run() deals the tasks of a job
+ *  round-robin over the deques; workers pop from the bottom of their own deque and,
+ *  when it runs dry, steal from the top of the others. The calling thread helps to
+ *  execute tasks until its job is complete, so several threads may run jobs on the
+ *  same pool concurrently.
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pattern_detector.h"
+
+/*! Job: a batch of tasks submitted by one thread_pool_run() call */
+typedef struct {
+  task_func_t func;
+  void *arg;
+  int remaining;                //!< tasks not yet completed (accessed atomically)
+} job_t;
+
+/*! Deque entry */
+typedef struct {
+  job_t *job;
+  int task;
+} task_t;
+
+/*! Per-worker task deque */
+typedef struct {
+  pthread_mutex_t lock;
+  task_t *tasks;
+  int capacity;
+  int top, bottom;              //!< tasks[top..bottom) are queued, indices modulo capacity
+} deque_t;
+
+struct thread_pool {
+  int threads;
+  deque_t *deques;              //!< threads + 1 deques, the last one for tasks dealt to callers
+  pthread_t *workers;
+  int started;
+  pthread_mutex_t lock;
+  pthread_cond_t work_cond;     //!< signalled when tasks are queued
+  pthread_cond_t done_cond;     //!< signalled when a job completes
+  int pending;                  //!< tasks not yet taken, counted before they are queued (accessed atomically)
+  int next_deque;               //!< round-robin start for dealing tasks
+  int shutdown;
+};
+
+/*! Push task to the bottom of a deque, growing it if needed */
+static int deque_push (deque_t *dq, job_t *job, int task)
+{
+  task_t *tasks;
+  int i, n;
+
+  pthread_mutex_lock(&dq->lock);
+  n = dq->bottom - dq->top;
+  if (n == dq->capacity) {
+    if ((tasks = (task_t *) malloc(2 * dq->capacity * sizeof(task_t))) == NULL) {
+      pthread_mutex_unlock(&dq->lock);
+      return 1;
+    }
+    for (i=0; i<n; i++) tasks[i] = dq->tasks[(dq->top + i) % dq->capacity];
+    free(dq->tasks);
+    dq->tasks = tasks;
+    dq->capacity *= 2;
+    dq->top = 0;
+    dq->bottom = n;
+  }
+  dq->tasks[dq->bottom % dq->capacity].job = job;
+  dq->tasks[dq->bottom % dq->capacity].task = task;
+  dq->bottom ++;
+  pthread_mutex_unlock(&dq->lock);
+  return 0;
+}
+
+/*! Take task from bottom (own deque) or top (stealing) */
+static int deque_take (deque_t *dq, int steal, task_t *t)
+{
+  int found = 0;
+  pthread_mutex_lock(&dq->lock);
+  if (dq->bottom > dq->top) {
+    if (steal) *t = dq->tasks[dq->top++ % dq->capacity];
+    else       *t = dq->tasks[--dq->bottom % dq->capacity];
+    found = 1;
+    /* restart from 0 when drained, so that indices stay bounded over a long run */
+    if (dq->top == dq->bottom)
+      dq->top = dq->bottom = 0;
+  }
+  pthread_mutex_unlock(&dq->lock);
+  return found;
+}
+
+/*! Find a task: own deque first, then steal from the others */
+static int take_task (thread_pool_t *pool, int self, task_t *t)
+{
+  int i, n = pool->threads + 1;
+
+  if (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) == 0)
+    return 0;
+  if (deque_take(&pool->deques[self], 0, t))
+    goto found;
+  for (i=1; i<n; i++)
+    if (deque_take(&pool->deques[(self + i) % n], 1, t))
+      goto found;
+  return 0;
+
+found:
+  __atomic_sub_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL);
+  return 1;
+}
+
+/*! Execute task and signal its job if it was the last one */
+static void run_task (thread_pool_t *pool, task_t *t)
+{
+  t->job->func(t->job->arg, t->task);
+  if (__atomic_sub_fetch(&t->job->remaining, 1, __ATOMIC_ACQ_REL) == 0) {
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->done_cond);
+    pthread_mutex_unlock(&pool->lock);
+  }
+}
+
+/*! Worker thread */
+typedef struct {thread_pool_t *pool; int self;} worker_arg_t;
+
+static void *worker_thread (void *arg)
+{
+  thread_pool_t *pool = ((worker_arg_t *) arg)->pool;
+  int self = ((worker_arg_t *) arg)->self;
+  task_t t;
+
+  free(arg);
+  for (;;) {
+    if (take_task(pool, self, &t)) {
+      run_task(pool, &t);
+      continue;
+    }
+    pthread_mutex_lock(&pool->lock);
+    while (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) == 0 && !pool->shutdown)
+      pthread_cond_wait(&pool->work_cond, &pool->lock);
+    if (pool->shutdown && __atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) == 0) {
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+    pthread_mutex_unlock(&pool->lock);
+  }
+  return NULL;
+}
+
+/*!
+ *  \brief Create work-stealing thread pool
+ *
+ *  \param[in]  threads  - number of worker threads
+ *
+ *  \returns    pool, or NULL if out of memory or threads cannot be created
+ */
+thread_pool_t *thread_pool_create (int threads)
+{
+  thread_pool_t *pool;
+  worker_arg_t *wa;
+  int i;
+
+  if ((pool = (thread_pool_t *) calloc(1, sizeof(thread_pool_t))) == NULL)
+    return NULL;
+  pool->threads = threads;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+  pool->deques = (deque_t *) calloc(threads + 1, sizeof(deque_t));
+  pool->workers = (pthread_t *) calloc(threads, sizeof(pthread_t));
+  if (!pool->deques || !pool->workers) goto fail;
+  for (i=0; i<=threads; i++) {
+    pthread_mutex_init(&pool->deques[i].lock, NULL);
+    pool->deques[i].capacity = 64;
+    if ((pool->deques[i].tasks = (task_t *) malloc(64 * sizeof(task_t))) == NULL) goto fail;
+  }
+  for (pool->started=0; pool->started<threads; pool->started++) {
+    if ((wa = (worker_arg_t *) malloc(sizeof(worker_arg_t))) == NULL) goto fail;
+    wa->pool = pool;
+    wa->self = pool->started;
+    if (pthread_create(&pool->workers[pool->started], NULL, worker_thread, wa)) {free(wa); goto fail;}
+  }
+  return pool;
+
+fail:
+  thread_pool_destroy(pool);
+  return NULL;
+}
+
+/*!
+ *  \brief Run num_tasks tasks func(arg, 0..num_tasks-1) on the pool and wait for completion
+ *
+ *  The calling thread takes part in executing tasks. If tasks cannot be queued they are
+ *  executed by the caller.
+ */
+void thread_pool_run (thread_pool_t *pool, task_func_t func, void *arg, int num_tasks)
+{
+  job_t job;
+  task_t t;
+  int i, d, n = pool->threads + 1;
+
+  job.func = func;
+  job.arg = arg;
+  job.remaining = num_tasks;
+
+  /* count tasks before queuing them, so that a worker taking one at once cannot drive the count below 0: */
+  __atomic_add_fetch(&pool->pending, num_tasks, __ATOMIC_ACQ_REL);
+
+  /* deal tasks round-robin over deques: */
+  d = __atomic_fetch_add(&pool->next_deque, 1, __ATOMIC_RELAXED);
+  for (i=0; i<num_tasks; i++) {
+    if (deque_push(&pool->deques[(d + i) % n], &job, i)) {
+      /* out of memory: run the rest here */
+      __atomic_sub_fetch(&pool->pending, num_tasks - i, __ATOMIC_ACQ_REL);
+      for (; i<num_tasks; i++) {
+        func(arg, i);
+        __atomic_sub_fetch(&job.remaining, 1, __ATOMIC_ACQ_REL);
+      }
+      break;
+    }
+  }
+  pthread_mutex_lock(&pool->lock);
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->lock);
+
+  /* help until no tasks are left, then wait for this job to complete: */
+  while (__atomic_load_n(&job.remaining, __ATOMIC_ACQUIRE) > 0 && take_task(pool, pool->threads, &t))
+    run_task(pool, &t);
+  pthread_mutex_lock(&pool->lock);
+  while (__atomic_load_n(&job.remaining, __ATOMIC_ACQUIRE) > 0)
+    pthread_cond_wait(&pool->done_cond, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/*! Number of worker threads in pool */
+int thread_pool_size (thread_pool_t *pool)
+{
+  return pool->threads;
+}
+
+/*! Stop worker threads & release pool */
+void thread_pool_destroy (thread_pool_t *pool)
+{
+  int i;
+
+  if (pool == NULL) return;
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = 1;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->lock);
+  for (i=0; i<pool->started; i++)
+    pthread_join(pool->workers[i], NULL);
+
+  if (pool->deques) {
+    for (i=0; i<=pool->threads; i++) {
+      pthread_mutex_destroy(&pool->deques[i].lock);
+      free(pool->deques[i].tasks);
+    }
+  }
+  pthread_cond_destroy(&pool->work_cond);
+  pthread_cond_destroy(&pool->done_cond);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->deques);
+  free(pool->workers);
+  free(pool);
+}
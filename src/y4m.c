@@ -0,0 +1,107 @@
+/*!
+ *  \file     y4m.c
+ *  \brief    Y4M (YUV4MPEG2) stream header parser
+ *
+ *  The stream header is a single line: "YUV4MPEG2" followed by space-separated tags,
+ *  each a tag letter and its value, e.g. "YUV4MPEG2 W1920 H1080 F30000:1001 It C420jpeg".
+ *  Unknown tags (aspect ratio, comments, ...) are ignored.
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pattern_detector.h"
+
+/*! Colorspace tag values */
+static const struct {
+  const char *name;
+  int format, bitdepth;
+} y4m_colorspaces[] = {
+  {"420",       FORMAT_YUV420, 8},
+  {"420jpeg",   FORMAT_YUV420, 8},
+  {"420paldv",  FORMAT_YUV420, 8},
+  {"420mpeg2",  FORMAT_YUV420, 8},
+  {"422",       FORMAT_YUV422, 8},
+  {"444",       FORMAT_YUV444, 8},
+  {"420p10",    FORMAT_YUV420, 10},
+  {"422p10",    FORMAT_YUV422, 10},
+  {"444p10",    FORMAT_YUV444, 10},
+  {"420p12",    FORMAT_YUV420, 12},
+  {"422p12",    FORMAT_YUV422, 12},
+  {"444p12",    FORMAT_YUV444, 12},
+  {"420p16",    FORMAT_YUV420, 16},
+  {"422p16",    FORMAT_YUV422, 16},
+  {"444p16",    FORMAT_YUV444, 16},
+  {"mono",      FORMAT_YUV400, 8},
+  {"mono10",    FORMAT_YUV400, 10},
+  {"mono12",    FORMAT_YUV400, 12},
+  {"mono16",    FORMAT_YUV400, 16},
+};
+
+/*!
+ *  \brief Parse Y4M stream header
+ *
+ *  \param[in]  line    - header line, without terminating newline
+ *  \param[out] info    - stream parameters; colorspace defaults to 4:2:0 8-bit if not tagged
+ *
+ *  \returns    0 if success, !0 if header is invalid or colorspace is not supported
+ */
+int y4m_parse_header (const char *line, y4m_info_t *info)
+{
+  const char *tag, *end;
+  char value[64];
+  int i, len;
+
+  memset(info, 0, sizeof(y4m_info_t));
+  info->format = FORMAT_YUV420;
+  info->bitdepth = 8;
+  info->scan_type = SCAN_UNKNOWN;
+
+  if (strncmp(line, Y4M_SIGNATURE, 9))
+    return 1;
+
+  for (tag = line + 9; *tag; tag = end) {
+    while (*tag == ' ') tag++;
+    if (*tag == 0) break;
+    for (end = tag; *end && *end != ' '; end++) ;
+    len = (int)min(end - tag - 1, (long)sizeof(value) - 1);
+    memcpy(value, tag + 1, len);
+    value[len] = 0;
+
+    switch (*tag) {
+      case 'W': info->res.width = atoi(value); break;
+      case 'H': info->res.height = atoi(value); break;
+      case 'F':
+        info->fps.num = atoi(value);
+        info->fps.denom = strchr(value, ':')? atoi(strchr(value, ':') + 1): 0;
+        break;
+      case 'I':
+        switch (value[0]) {
+          case 'p': info->scan_type = SCAN_PROGRESSIVE; break;
+          case 't': info->scan_type = SCAN_INTERLACE_TFF; break;
+          case 'b': info->scan_type = SCAN_INTERLACE_BFF; break;
+          default:  info->scan_type = SCAN_UNKNOWN; break;     // 'm' (mixed) or '?'
+        }
+        break;
+      case 'C':
+        for (i=0; i<(int)(sizeof(y4m_colorspaces)/sizeof(y4m_colorspaces[0])); i++)
+          if (!strcmp(value, y4m_colorspaces[i].name)) break;
+        if (i == (int)(sizeof(y4m_colorspaces)/sizeof(y4m_colorspaces[0])))
+          return 1;
+        info->format = y4m_colorspaces[i].format;
+        info->bitdepth = y4m_colorspaces[i].bitdepth;
+        break;
+    }
+  }
+
+  /* check if mandatory tags are present and valid: */
+  return (info->res.width <= 0 || info->res.height <= 0 || info->res.width > MAX_WIDTH || info->res.height > MAX_HEIGHT ||
+          (info->res.height & 1) || info->fps.num <= 0 || info->fps.denom <= 0)? 1: 0;
+}
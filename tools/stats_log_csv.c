@@ -0,0 +1,102 @@
+/*!
+ *  \file     stats_log_csv.c
+ *  \brief    Convert binary stats log of detect_pattern to CSV
+ *
+ *  The log is memory-mapped and its columns read in place. Output has one line per
+ *  frame, with the columns of the text log, prefixed with the input frame number;
+ *  with -b, the gamma of each block is appended (if it was logged).
+ *
+ *  Usage: stats_log_csv [-b] <stats log> [output.csv]
+ *
+ *  \version  1.0.00
+ *  \date     Tue Feb. 5, 2019
+ *
+ *  \authors  Xiangbo Li
+ *
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pattern_detector.h"
+
+int main (int argc, char *argv[])
+{
+  const stats_log_header_t *h;
+  const unsigned char *base, *chunk;
+  size_t offsets[STATS_COLUMNS], chunks;
+  struct stat st;
+  FILE *out = stdout;
+  uint32_t count, i, b, blocks;
+  int fd, c, arg = 1, block_stats = 0;
+
+  if (arg < argc && !strcmp(argv[arg], "-b")) {
+    block_stats = 1;
+    arg ++;
+  }
+  if (arg >= argc || argc - arg > 2) {
+    fprintf(stderr, "Usage: %s [-b] <stats log> [output.csv]\n", argv[0]);
+    return 1;
+  }
+
+  /* map log & check header: */
+  if ((fd = open(argv[arg], O_RDONLY)) < 0 || fstat(fd, &st) || st.st_size < (off_t)sizeof(stats_log_header_t)) {
+    fprintf(stderr, "ERROR: Cannot read %s\n", argv[arg]);
+    return 1;
+  }
+  if ((base = (const unsigned char *) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+    fprintf(stderr, "ERROR: Cannot map %s\n", argv[arg]);
+    return 1;
+  }
+  h = (const stats_log_header_t *) base;
+  if (memcmp(h->magic, STATS_LOG_MAGIC, sizeof(STATS_LOG_MAGIC)) || h->version != STATS_LOG_VERSION || h->chunk_size == 0
+   || h->chunk_size != stats_log_column(h, STATS_COLUMNS)) {
+    fprintf(stderr, "ERROR: %s is not a stats log of this version\n", argv[arg]);
+    return 1;
+  }
+  if (arg + 1 < argc && (out = fopen(argv[arg + 1], "w")) == NULL) {
+    fprintf(stderr, "ERROR: Cannot create %s\n", argv[arg + 1]);
+    return 1;
+  }
+  for (c=0; c<STATS_COLUMNS; c++)
+    offsets[c] = stats_log_column(h, c);
+  blocks = block_stats? h->block_cols * h->block_rows: 0;
+  chunks = (st.st_size - h->header_size) / h->chunk_size;
+
+  /* header line: */
+  fprintf(out, "frame,delta_frame,delta_even,delta_odd,gamma,combed_blocks,match,drop,phase,order");
+  for (b=0; b<blocks; b++)
+    fprintf(out, ",block_%u_%u", b / h->block_cols, b % h->block_cols);
+  fprintf(out, "\n");
+
+  /* frames of each chunk: */
+  for (chunk = base + h->header_size; chunks > 0; chunks--, chunk += h->chunk_size) {
+    memcpy(&count, chunk, sizeof(uint32_t));
+    for (i=0; i<count && i<h->chunk_frames; i++) {
+      fprintf(out, "%d,%8.5f,%8.5f,%8.5f,%8.5f,%d,%c,%d,%d,%c",
+              ((const int32_t *)(chunk + offsets[STATS_FRAME]))[i],
+              ((const float *)(chunk + offsets[STATS_DELTA_FRAME]))[i],
+              ((const float *)(chunk + offsets[STATS_DELTA_EVEN]))[i],
+              ((const float *)(chunk + offsets[STATS_DELTA_ODD]))[i],
+              ((const float *)(chunk + offsets[STATS_GAMMA]))[i],
+              ((const int32_t *)(chunk + offsets[STATS_COMBED_BLOCKS]))[i],
+              ((const int8_t *)(chunk + offsets[STATS_MATCH]))[i],
+              ((const int8_t *)(chunk + offsets[STATS_DROP]))[i],
+              ((const int8_t *)(chunk + offsets[STATS_PHASE]))[i],
+              ((const int8_t *)(chunk + offsets[STATS_ORDER]))[i]);
+      for (b=0; b<blocks; b++)
+        fprintf(out, ",%.4f", ((const float *)(chunk + offsets[STATS_BLOCK_GAMMA]))[(size_t)i * blocks + b]);
+      fprintf(out, "\n");
+    }
+  }
+
+  if (out != stdout) fclose(out);
+  munmap((void *)base, st.st_size);
+  close(fd);
+  return 0;
+}